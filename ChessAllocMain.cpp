@@ -0,0 +1,119 @@
+#include "ChessBoard.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+using namespace std;
+
+/* Allocation check of the rules path: counts the heap allocations made by submitMove().
+Usage: allocations [-g games] [-p max plies] [-s seed]
+Every game plays random legal moves with submitMove(), once with the board's messages written to a stream that discards them and once with the messages turned off. The operator new of the whole program is replaced by one that counts calls, and the count is read before and after each submitMove() (choosing the move and naming its squares happen outside). The allocations are reported for quiet moves, captures and castling; the program fails (exit code 1) if any move that takes nothing allocated. */
+
+static size_t allocation_count = 0;
+
+void *operator new(size_t size) {
+    allocation_count++;
+    void *memory = malloc((size > 0) ? size : 1);
+    if (memory == NULL)
+        throw bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size) {
+    allocation_count++;
+    void *memory = malloc((size > 0) ? size : 1);
+    if (memory == NULL)
+        throw bad_alloc();
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    free(memory);
+}
+
+/* Stream buffer that accepts and drops every character without allocating. */
+class DiscardBuffer : public streambuf {
+    protected:
+        int overflow(int c) override {
+            return c;
+        }
+};
+
+static void usage() {
+    cerr << "Usage: allocations [-g games] [-p max plies] [-s seed]" << endl;
+}
+
+int main(int argc, char **argv) {
+    int games = 200, max_plies = 200;
+    uint64_t seed = 1;
+    for (int i=1; i<argc; i++) {
+        if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+            games = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+            max_plies = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            seed = strtoull(argv[++i], NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    DiscardBuffer discard;
+    ostream messages(&discard);
+    static const char *const KIND_NAMES[3] = {"quiet moves", "captures", "castling moves"};
+    bool failed = false;
+    for (int silent=0; silent<2; silent++) {
+        /* Index 0 counts the quiet moves, 1 the captures and 2 the castling moves. */
+        uint64_t moves[3] = {0, 0, 0}, allocations[3] = {0, 0, 0}, allocating_moves[3] = {0, 0, 0};
+        uint64_t state = seed;
+        ChessBoard board(PackedPosition::starting_position());
+        board.set_output(silent ? NULL : &messages, silent ? NULL : &messages);
+        ChessMove legal[MAX_MOVES];
+        for (int game=0; game<games; game++) {
+            board.unpack(PackedPosition::starting_position());
+            for (int ply=0; ply<max_plies; ply++) {
+                int count = board.legal_moves(legal);
+                if (count == 0)
+                    break;
+                ChessMove move = legal[splitmix64(state) % count];
+                int piece = board.piece_at(move.from);
+                int kind = (board.piece_at(move.to) >= 0) ? 1 : 0;
+                if (((piece & 7) == 0) && (abs(move.from % 8 - move.to % 8) == 2))
+                    kind = 2;
+                char from[3], to[3];
+                square_name(move.from, from);
+                square_name(move.to, to);
+
+                size_t before = allocation_count;
+                board.submitMove(from, to);
+                size_t made = allocation_count - before;
+                moves[kind]++;
+                allocations[kind] += made;
+                allocating_moves[kind] += (made > 0) ? 1 : 0;
+            }
+        }
+
+        printf("Messages %s:\n", silent ? "off" : "written to a stream");
+        for (int kind=0; kind<3; kind++)
+            printf("  %llu %s, %llu allocations (%llu moves allocating)\n", (unsigned long long)moves[kind], KIND_NAMES[kind], (unsigned long long)allocations[kind], (unsigned long long)allocating_moves[kind]);
+        failed = failed || (allocating_moves[0] + allocating_moves[2] > 0);
+    }
+    printf("%s\n", failed ? "FAILED: a move taking nothing allocated" : "No allocation by moves taking nothing");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+#ifndef CHESSBITBOARD_H
+#define CHESSBITBOARD_H
+#include <cstdint>
+#include "ChessTables.h"
+
+using namespace std;
+
+/* Helpers for 64-bit square sets (bitboards). Square numbering is the same as PackedPosition: square = rank * 8 + file, so A1 is 0, H1 is 7 and H8 is 63. The attack sets come from the precomputed SQUARE_TABLES and SLIDING_ATTACKS. */
+
+/* Write the name of a square (e.g. "E4", as accepted by ChessBoard::submitMove()) into name, which must hold 3 characters. */
+inline void square_name(int const square, char name[3]) {
+    name[0] = 'A' + square % 8;
+    name[1] = '1' + square / 8;
+    name[2] = '\0';
+}
+
+/* Return the square named by the first 2 characters of name (file 'A' to 'H' in either case, then rank '1' to '8'), or -1 if they do not name a square. */
+inline int square_from_name(const char *name) {
+    char file = (name[0] >= 'a') ? name[0] - 'a' + 'A' : name[0];
+    if ((file < 'A') || (file > 'H') || (name[1] < '1') || (name[1] > '8'))
+        return -1;
+    return (name[1] - '1') * 8 + (file - 'A');
+}
+
+/* Return the bitboard with only the given square set. */
+inline uint64_t square_bit(int const square) {
+    return 1ULL << square;
+}
+
+/* Return the number of squares set in the bitboard. */
+inline int bit_count(uint64_t const bits) {
+    return __builtin_popcountll(bits);
+}
+
+/* Return the lowest square set in a non-empty bitboard. */
+inline int lowest_square(uint64_t const bits) {
+    return __builtin_ctzll(bits);
+}
+
+/* Return the highest square set in a non-empty bitboard. */
+inline int highest_square(uint64_t const bits) {
+    return 63 - __builtin_clzll(bits);
+}
+
+/* Return the squares a knight on the given square can move to. */
+inline uint64_t knight_attacks(int const square) {
+    return SQUARE_TABLES.knight[square];
+}
+
+/* Return the squares a king on the given square can move to. */
+inline uint64_t king_attacks(int const square) {
+    return SQUARE_TABLES.king[square];
+}
+
+/* Return the squares a pawn of the given team on the given square attacks (the diagonal squares one rank ahead). */
+inline uint64_t pawn_attacks(int const square, bool const white) {
+    return SQUARE_TABLES.pawn_attacks[white ? 0 : 1][square];
+}
+
+/* Return the squares reached from the square in one direction, up to the edge of the board or the first occupied square (which is included).
+@param square: the square the slider stands on.
+@param occupied: the occupied squares of the board.
+@param direction: one of SquareTables::ray_directions. */
+inline uint64_t ray_attacks(int const square, uint64_t const occupied, int const direction) {
+    uint64_t ray = SQUARE_TABLES.rays[square][direction];
+    uint64_t blockers = ray & occupied;
+    if (blockers == 0)
+        return ray;
+    /* Rays going up the board hold only squares above the slider, so the nearest blocker is the lowest one; for rays going down it is the highest one. Cut the ray off behind it. */
+    int nearest = (ray > square_bit(square)) ? lowest_square(blockers) : highest_square(blockers);
+    return ray ^ SQUARE_TABLES.rays[nearest][direction];
+}
+
+/* Return the index of the attack set of a slider among those of its square (see SlidingAttacks).
+@param entry: the lookup data of the square for the kind of slider.
+@param occupied: the occupied squares of the board.
+@param pext: true to gather the relevant occupied squares with PEXT, false to use the magic multiplication. */
+inline uint64_t sliding_index(SlidingAttacks::Entry const &entry, uint64_t const occupied, bool const pext) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (pext) {
+        /* Written in assembly so the program does not have to be compiled for BMI2: the instruction only runs on CPUs that have it. */
+        uint64_t index;
+        __asm__("pextq %2, %1, %0" : "=r"(index) : "r"(occupied), "r"(entry.mask));
+        return index;
+    }
+#endif
+    return ((occupied & entry.mask) * entry.magic) >> entry.shift;
+}
+
+/* Return the squares a rook on the given square attacks with the given occupancy. */
+inline uint64_t rook_attacks(int const square, uint64_t const occupied) {
+    SlidingAttacks::Entry const &entry = SLIDING_ATTACKS.rook[square];
+    return SLIDING_ATTACKS.attacks[entry.offset + sliding_index(entry, occupied, SLIDING_ATTACKS.pext)];
+}
+
+/* Return the squares a bishop on the given square attacks with the given occupancy. */
+inline uint64_t bishop_attacks(int const square, uint64_t const occupied) {
+    SlidingAttacks::Entry const &entry = SLIDING_ATTACKS.bishop[square];
+    return SLIDING_ATTACKS.attacks[entry.offset + sliding_index(entry, occupied, SLIDING_ATTACKS.pext)];
+}
+
+#endif
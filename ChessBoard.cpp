@@ -1,5 +1,7 @@
 #include <iostream>
+#include <algorithm>
 #include "ChessBoard.h"
+#include "ChessFeed.h"
 
 using namespace std;
 
@@ -47,12 +49,96 @@ ChessBoard::ChessBoard() {
     /* Initialise the state of the game */
     game_over = false;
 
-    cout << "A new chess game is started!" << endl;
+    /* No evaluation network or move feed is attached until attach_network() or attach_feed() is called */
+    network = NULL;
+    feed = NULL;
+    feed_game = 0;
+
+    /* Messages go to the standard streams until set_output() is called */
+    output = &cout;
+    errors = &cerr;
+    refresh_incremental_state();
+    destinations_valid = false;
+    publish_snapshot();
+
+    if (output != NULL)
+        *output << "A new chess game is started!" << endl;
+}
+
+
+
+ChessBoard::ChessBoard(PackedPosition const &position) {
+
+    /* Initiate a NULL pointer for the all positions on the board before placing the packed chess pieces */
+    for (int i=0; i<8; i++){
+        for (int j=0; j<8; j++)
+            board[i][j] = NULL;
+    }
+
+    network = NULL;
+    feed = NULL;
+    feed_game = 0;
+    output = &cout;
+    errors = &cerr;
+    destinations_valid = false;
+    unpack(position);
+}
+
+
+
+ChessBoard::ChessBoard(ChessBoard const &other) {
+    for (int i=0; i<8; i++){
+        for (int j=0; j<8; j++)
+            board[i][j] = NULL;
+    }
+    feed = NULL;
+    feed_game = 0;
+    destinations_valid = false;
+    *this = other;
 }
 
 
 
-bool ChessBoard::check_valid_str_position(string const old_position, string const new_position) const {
+ChessBoard &ChessBoard::operator=(ChessBoard const &other) {
+    if (this == &other)
+        return *this;
+
+    /* Replace every chess piece by a duplicate of the other board's piece, keeping its move counter. */
+    clear_board();
+    for (int i=0; i<8; i++) {
+        for (int j=0; j<8; j++) {
+            ChessPiece const *piece = other.board[i][j];
+            if (piece != NULL) {
+                board[i][j] = create_piece(piece_code(piece));
+                board[i][j]->move_counter = piece->move_counter;
+            }
+        }
+    }
+
+    /* Copy the state of the game and the incremental state as they are. */
+    white = other.white;
+    for (int i=0; i<2; i++) {
+        white_kings_location[i] = other.white_kings_location[i];
+        black_kings_location[i] = other.black_kings_location[i];
+    }
+    game_over = other.game_over;
+    network = other.network;
+    output = other.output;
+    errors = other.errors;
+    accumulator = other.accumulator;
+    piece_key = other.piece_key;
+    occupied = other.occupied;
+    pawn_piece_key = other.pawn_piece_key;
+    pawn_squares[0] = other.pawn_squares[0];
+    pawn_squares[1] = other.pawn_squares[1];
+    destinations_valid = false;
+    publish_snapshot();
+    return *this;
+}
+
+
+
+bool ChessBoard::check_valid_str_position(string_view const old_position, string_view const new_position) const {
     
     /* Ensure that both positions' strings are of length 2 */
     if ((old_position.length() != 2) || (new_position.length() !=2))
@@ -84,9 +170,9 @@ bool ChessBoard::check_king_test(int const king_rank, int const king_file) const
         for (int j=0; j<8; j++) {
             ChessPiece* test_piece = board[i][j];
             /* Begin checks if the position we are looking at 1. is not empty, 2. is not the king's position we are looking at, 3. contains an opponent's piece */
-            if ((test_piece != NULL) && ((i != king_rank) || (j != king_file)) && (test_piece->get_team() != king_piece->get_team())) {
+            if ((test_piece != NULL) && ((i != king_rank) || (j != king_file)) && (test_piece->white != king_piece->white)) {
                 /* Attempt to move the piece to the king position we are looking at. */
-                if (test_piece->check_piece_logic(i, j, king_rank, king_file, board) && !(test_piece->check_obstruction(i, j, king_rank, king_file, board))) {
+                if (test_piece->check_piece_logic(i, j, king_rank, king_file, board) && !(test_piece->check_obstruction(i, j, king_rank, king_file, occupied))) {
                     return true;
                 }
             }
@@ -101,9 +187,12 @@ void ChessBoard::temp_make_move(int const old_rank, int const old_file, int cons
         /* Temporarily store the new location to for undo_move() later */
         temp = board[new_rank][new_file];
         board[new_rank][new_file] = board[old_rank][old_file];
+        occupied |= square_bit(new_rank * 8 + new_file);
         /* Set the source position to point to null if it's not the same position. */
-        if (!((new_rank == old_rank) && (new_file == old_file))) 
+        if (!((new_rank == old_rank) && (new_file == old_file))) {
             board[old_rank][old_file] = NULL;
+            occupied &= ~square_bit(old_rank * 8 + old_file);
+        }
 }
 
 
@@ -112,6 +201,10 @@ void ChessBoard::undo_temp_move(int const old_rank, int const old_file, int cons
         board[old_rank][old_file] = board[new_rank][new_file];
         /* Place the temporarile removed chess piece back to it's original position */
         board[new_rank][new_file] = temp;
+        occupied |= square_bit(old_rank * 8 + old_file);
+        /* The destination square is empty again unless a chess piece was taken from it (or the move was to the same square, where temp is the moved piece). */
+        if (temp == NULL)
+            occupied &= ~square_bit(new_rank * 8 + new_file);
 }
 
 
@@ -126,7 +219,11 @@ void ChessBoard::make_move(int const old_rank, int const old_file, int const new
 
     /* If the destination square is not empty. */
     if (board[new_rank][new_file] != NULL) {
-        cout << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " moves from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << " taking " << board[new_rank][new_file]->get_team() << "'s " << board[new_rank][new_file]->get_cptype() << endl;
+        if (output != NULL)
+            *output << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " moves from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << " taking " << board[new_rank][new_file]->get_team() << "'s " << board[new_rank][new_file]->get_cptype() << endl;
+        /* Take both the captured and the moved piece out of the incremental state. */
+        update_removed_piece(new_rank, new_file);
+        update_removed_piece(old_rank, old_file);
         /* Remove the opponent's piece. */
         delete board[new_rank][new_file];
         /* Make the destination source point to the moved chess piece. */
@@ -137,11 +234,16 @@ void ChessBoard::make_move(int const old_rank, int const old_file, int const new
     }
     /* If the destination square is empty. */
     else {
-        cout << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " moves from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << endl;
+        if (output != NULL)
+            *output << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " moves from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << endl;
+        update_removed_piece(old_rank, old_file);
         board[new_rank][new_file] = board[old_rank][old_file];
         board[old_rank][old_file] = NULL;
         board[new_rank][new_file]->increase_move_counter();
     }
+    /* Add the moved piece back to the incremental state on its new square. */
+    update_added_piece(new_rank, new_file);
+    destinations_valid = false;
 }
 
 
@@ -157,7 +259,7 @@ int ChessBoard::valid_move_counter(int const king_rank, int const king_file) {
             /* Check and only attempt to move the chess piece if the current location has an opponent's chess piece. */
             if (board[i][j] != NULL) {
                 ChessPiece* test_piece = board[i][j];
-                if (test_piece->get_team() == board[king_rank][king_file]->get_team()) {
+                if (test_piece->white == board[king_rank][king_file]->white) {
                     
                     /* k and l represents the position we attempt to move the chess piece to. */
                     for (int k=0; k<8; k++){
@@ -202,17 +304,19 @@ int ChessBoard::valid_move_counter(int const king_rank, int const king_file) {
 
 
 
-void ChessBoard::submitMove(string const old_position, string const new_position) {
+void ChessBoard::submitMove(string_view const old_position, string_view const new_position) {
 
     /* Check if the game is over */
     if (game_over) {
-        cout << "Game is over, no move is allowed." << endl;
+        if (output != NULL)
+            *output << "Game is over, no move is allowed." << endl;
         return;
     }
 
     /* Check that both arguments passed for source and destination sqaures are valid */
     if(!(check_valid_str_position(old_position, new_position))) {
-        cout << "Invalid position entered." << endl;
+        if (output != NULL)
+            *output << "Invalid position entered." << endl;
         return;
     }
 
@@ -222,26 +326,26 @@ void ChessBoard::submitMove(string const old_position, string const new_position
     int new_rank = new_position[1] - '1';
     int new_file = new_position[0] - 'A';
 
-    /* Get the current team that is making the move. */
-    string current_team;
-    if (white)
-        current_team = "White";
-    else
-        current_team = "Black";
-    
     /* Get the chess piece being moved. */
     ChessPiece* moved_piece = board[old_rank][old_file];
 
     /* Check if there is a chess piece at the source square. */
     if (moved_piece == NULL) {
-        cerr << "There is no piece at position " << old_position << "!" << endl;
+        if (errors != NULL)
+            *errors << "There is no piece at position " << old_position << "!" << endl;
         return;
     }
 
+    /* Delta of the move for the attached feed, its status filled in once the move is made. */
+    FeedDelta delta = {feed_game, uint8_t(old_rank * 8 + old_file), uint8_t(new_rank * 8 + new_file), FEED_NO_CAPTURE, 0};
+    if (board[new_rank][new_file] != NULL)
+        delta.captured = piece_code(board[new_rank][new_file]);
+
     /* Start castling check if moved piece is an unmoved king and position moved is 2 squares along the same rank. */
-    if ((moved_piece->get_cptype() == "King") && (moved_piece->get_move_count() == 0) && (abs(old_file-new_file) == 2) && (moved_piece->get_team() == current_team)) {
+    if ((moved_piece->cptype == ChessPiece::king) && (moved_piece->move_counter == 0) && (abs(old_file-new_file) == 2) && (moved_piece->white == white)) {
         if (castling_check(old_file, new_file)) {
             make_castling_move(old_rank, old_file, new_rank, new_file);
+            delta.flags = FEED_CASTLING;
         }
         /* If castling check fails, do nothing then exit for user to resubmit valid move. */
         else {
@@ -251,8 +355,9 @@ void ChessBoard::submitMove(string const old_position, string const new_position
     /* Otherwise, perform normal checks */
     else {        
         /* Check if the current turn belongs to the team of the piece at the source square. */
-        if (moved_piece->get_team() != current_team) {
-            cout << "It is not " << moved_piece->get_team() << "'s turn to move!" << endl;
+        if (moved_piece->white != white) {
+            if (output != NULL)
+                *output << "It is not " << moved_piece->get_team() << "'s turn to move!" << endl;
             return;
         }
 
@@ -262,40 +367,17 @@ void ChessBoard::submitMove(string const old_position, string const new_position
         /* Check if the move is valid based on the current piece's logic and if there is an obstruction along the way. */
         move_valid = moved_piece->valid_move(old_rank, old_file, new_rank, new_file, *this);
         
-        /* Create a temporary piece for un-doing move later */
-        ChessPiece* temp_piece = NULL;
-        /* Simulate the board config after making the move */
-        temp_make_move(old_rank, old_file, new_rank, new_file, temp_piece);
-
-        /* Identify king's position based on whether or not the moved piece is a king chess piece. */
-        int new_own_king_location[2];
-        if (moved_piece->get_cptype() == "King"){
-                new_own_king_location[0] = new_rank;
-                new_own_king_location[1] = new_file;
-        }
-        else {
-            if (moved_piece->get_team() == "White") {
-                new_own_king_location[0] = white_kings_location[0];
-                new_own_king_location[1] = white_kings_location[1];
-            }
-            else {
-                new_own_king_location[0] = black_kings_location[0];
-                new_own_king_location[1] = black_kings_location[1];
-            }
-        }
-
-        /* Check if the move will leave it's own king in check. */
-        own_king_check = check_king_test(new_own_king_location[0], new_own_king_location[1]);
+        /* Check if the move will leave it's own king in check, looking at the board as if the move was made (without changing it). */
+        own_king_check = !king_safe_after(old_rank * 8 + old_file, new_rank * 8 + new_file);
 
         /* If move is valid and does not leave own king in check, make the move officially. */
         if (move_valid && !own_king_check) {
-            undo_temp_move(old_rank, old_file, new_rank, new_file, temp_piece);
             make_move(old_rank, old_file, new_rank, new_file);
         }
         /* If the move is not valid, reject the move entirely and print the following error message. */
         else {
-            undo_temp_move(old_rank, old_file, new_rank, new_file, temp_piece);
-            cout << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " cannot move to "<< new_position << "!" << endl;
+            if (output != NULL)
+                *output << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " cannot move to "<< new_position << "!" << endl;
             return;
         }
     }
@@ -303,11 +385,11 @@ void ChessBoard::submitMove(string const old_position, string const new_position
     moved_piece = board[new_rank][new_file];
     
     /* Update the kings position on the board if the moved chess piece is a king chess piece. */
-    if ((moved_piece->get_cptype() == "King") && moved_piece->get_team() == "White") {
+    if ((moved_piece->cptype == ChessPiece::king) && moved_piece->white) {
         white_kings_location[0] = new_rank;
         white_kings_location[1] = new_file;
     }
-    else if ((moved_piece->get_cptype() == "King") && !(moved_piece->get_team() == "White")) {
+    else if ((moved_piece->cptype == ChessPiece::king) && !moved_piece->white) {
         black_kings_location[0] = new_rank;
         black_kings_location[1] = new_file;
     }
@@ -331,28 +413,38 @@ void ChessBoard::submitMove(string const old_position, string const new_position
 
     /* If current move leaves the opponent's king in check and opponent has 0 valid move next, the current move checkmates the opponent. */
     if ((available_moves_after_this <= 0) && check) {
-        cout << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " is in checkmate" << endl;
+        if (output != NULL)
+            *output << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " is in checkmate" << endl;
         white = !white;
         game_over = true;
+        delta.flags |= game_checkmate;
+        publish_snapshot(delta);
         return;
     }
     /* If current move leaves the opponent's king in check and opponent has more than 0 valid moves next, the current move checks the opponent. */
     if ((available_moves_after_this > 0) && check) {
-        cout << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " is in check" << endl;
+        if (output != NULL)
+            *output << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " is in check" << endl;
         white = !white;
+        delta.flags |= game_check;
+        publish_snapshot(delta);
         return;
     }
     /* If current move does not leave the opponent's king in check and opponent 0 valid moves next, the game ends with a stalemate. */
     if ((available_moves_after_this <= 0) && !check) {
-        cout << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " has no move after this. Stalemate!" << endl;
+        if (output != NULL)
+            *output << board[opponent_king_location[0]][opponent_king_location[1]]->get_team() << " has no move after this. Stalemate!" << endl;
         white = !white;
         game_over = true;
+        delta.flags |= game_stalemate;
+        publish_snapshot(delta);
         return;
     }
     /* If current move does not leave the opponent's king in check and opponent has more than 0 valid moves next, the game continues per normal. */
     if ((available_moves_after_this > 0) && !check) {
         /* Update that the next move is to be made by team of another color. */
         white = !white;
+        publish_snapshot(delta);
         return;
     }
 
@@ -408,7 +500,13 @@ void ChessBoard::resetBoard() {
     /* Re-initialise the state of the game */
     game_over = false;
 
-    cout << "A new chess game is started!" << endl;
+    /* Recompute the piece key and network accumulator for the starting position */
+    refresh_incremental_state();
+    destinations_valid = false;
+    publish_snapshot();
+
+    if (output != NULL)
+        *output << "A new chess game is started!" << endl;
 }
 
 
@@ -444,19 +542,22 @@ bool ChessBoard::castling_check(int const old_king_file, int const new_king_file
 
     /* Check if there is obstruction between the king and the rook */
     if (!(castling_obstruction_check(old_king_file, new_king_file, king_rank))) {
-        cout << "There is obstruction between the king and the rook piece. Castling not valid." << endl;
+        if (output != NULL)
+            *output << "There is obstruction between the king and the rook piece. Castling not valid." << endl;
         return false;
     };
 
     /* Check if there is a valid rook piece for castling */
     if (!(castling_rook_check(old_king_file, new_king_file, king_rank))) {
-        cout << "There is no valid rook chess piece. Castling not valid." << endl;
+        if (output != NULL)
+            *output << "There is no valid rook chess piece. Castling not valid." << endl;
         return false;
     };
 
     /* Check if the king will be checked from it's original position to the new position when castling */
     if (!(castling_king_check(old_king_file, new_king_file, king_rank))) {
-        cout << "King get's checked while castling, castling is not valid." << endl;
+        if (output != NULL)
+            *output << "King get's checked while castling, castling is not valid." << endl;
         return false;
     };
 
@@ -465,45 +566,15 @@ bool ChessBoard::castling_check(int const old_king_file, int const new_king_file
 
 
 
-bool ChessBoard::castling_king_check(int const old_king_file, int const new_king_file, int const king_rank) {
-    /* Create new file for iteration to check if the king is in check as it moves to and when it is at it's new position */
-    int king_file_checked = old_king_file;
-
-    /* When the king moves to the king side */
-    if (old_king_file < new_king_file) {
-        /* Move from the old position to the new position to see if the king piece will get checked */
-        while (king_file_checked <= new_king_file) {
-            /* Create a temporary piece for un-doing move later */
-            ChessPiece *temp_piece;
-            /* Simulate the board config after making the move */
-            temp_make_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-            /* Check if the king can be checked as it moves along the rank */
-            if (check_king_test(king_rank, king_file_checked)) {
-                /* Undo the temporary move */
-                undo_temp_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-                return false;
-            }
-            undo_temp_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-            king_file_checked++;
-        }
-    }
-
-    /* When the king moves to the queen side */
-    if (old_king_file > new_king_file) {
-        /* Move from the old position to the new position to see if the king piece will get checked */
-        while (king_file_checked >= new_king_file) {
-            ChessPiece *temp_piece;
-            temp_make_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-            if (check_king_test(king_rank, king_file_checked)) {
-                undo_temp_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-                return false;
-            }
-            undo_temp_move(king_rank, old_king_file, king_rank, king_file_checked, temp_piece);
-            king_file_checked--;
-        }
+bool ChessBoard::castling_king_check(int const old_king_file, int const new_king_file, int const king_rank) const {
+    /* Look for attackers of every square from the king's original square to its new one, as if the king stood on it (the board itself is not changed). */
+    int step = (old_king_file < new_king_file) ? 1 : -1;
+    int king_square = king_rank * 8 + old_king_file;
+    for (int king_file_checked=old_king_file; king_file_checked!=new_king_file+step; king_file_checked+=step) {
+        if (square_attacked(king_rank * 8 + king_file_checked, !white, king_square, king_rank * 8 + king_file_checked))
+            return false;
     }
     return true;
-
 }
 
 
@@ -534,7 +605,7 @@ bool ChessBoard::castling_rook_check(int const old_king_file, int const new_king
     if (old_king_file < new_king_file) {
         if(board[king_rank][7] != NULL) {
             /* Make sure that the chess piece at rook's original position is a rook piece and it has not make any move yet. */
-            if((board[king_rank][7]->get_cptype() != "Rook") || (board[king_rank][7]->get_move_count() != 0) || (board[king_rank][7]->get_team() != board[king_rank][old_king_file]->get_team()))
+            if((board[king_rank][7]->cptype != ChessPiece::rook) || (board[king_rank][7]->move_counter != 0) || (board[king_rank][7]->white != board[king_rank][old_king_file]->white))
                 return false;
         }
         else {
@@ -546,7 +617,7 @@ bool ChessBoard::castling_rook_check(int const old_king_file, int const new_king
     /* Do the same as above when the king moves to the queen side */
     if (old_king_file > new_king_file) {
         if(board[king_rank][0] != NULL) {
-            if((board[king_rank][0]->get_cptype() != "Rook") || (board[king_rank][0]->get_move_count() != 0) || (board[king_rank][0]->get_team() != board[king_rank][old_king_file]->get_team())) 
+            if((board[king_rank][0]->cptype != ChessPiece::rook) || (board[king_rank][0]->move_counter != 0) || (board[king_rank][0]->white != board[king_rank][old_king_file]->white)) 
                 return false;
         }
         else {
@@ -566,51 +637,833 @@ void ChessBoard::make_castling_move(int const old_rank, int const old_file, int
     new_file_char = 'A' + new_file;
 
     /* Print the castling message */
-    if (old_file > new_file)
-        cout << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " castles queen side from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << "." << endl;
-    else
-        cout << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " castles king side from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << "." << endl;
+    if (output != NULL) {
+        if (old_file > new_file)
+            *output << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " castles queen side from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << "." << endl;
+        else
+            *output << board[old_rank][old_file]->get_team() << "'s " << board[old_rank][old_file]->get_cptype() << " castles king side from " << old_file_char << old_rank_char << " to " << new_file_char << new_rank_char << "." << endl;
+    }
     
     /* Make move for king piece */
+    update_removed_piece(old_rank, old_file);
     /* Make the destination square point to the moved chess piece. */
     board[new_rank][new_file] = board[old_rank][old_file];
     board[old_rank][old_file] = NULL;
     /* Increase the move counter of the moved piece. */
     board[new_rank][new_file]->increase_move_counter();
+    update_added_piece(new_rank, new_file);
 
     /* Make move for rook piece */
     /* When the king moves to the king side */
     if (old_file < new_file) {
+        update_removed_piece(old_rank, 7);
         /* Increase the move counter of the rook piece. */
         board[old_rank][5] = board[old_rank][7];
         board[old_rank][7] = NULL;
         board[old_rank][5]->increase_move_counter(); 
+        update_added_piece(old_rank, 5);
     }
     /* When the king moves to the queen side */
     if (old_file > new_file) {
+        update_removed_piece(old_rank, 0);
         board[old_rank][3] = board[old_rank][0];
         board[old_rank][0] = NULL;
         board[old_rank][3]->increase_move_counter(); 
+        update_added_piece(old_rank, 3);
     }
+    destinations_valid = false;
 }
 
 
 
 /* Not for marking: function that prints board for debugging. */
 void ChessBoard::print_board() const {
-    cout << "-------------------------------------" << endl;
-    cout << "            Printing Board           " << endl;
-    cout << "-------------------------------------" << endl;  
-    cout << "    A   B   C   D   E   F   G   H" << endl;
-    cout << "   -------------------------------" << endl;
+    if (output == NULL)
+        return;
+    *output << "-------------------------------------" << endl;
+    *output << "            Printing Board           " << endl;
+    *output << "-------------------------------------" << endl;  
+    *output << "    A   B   C   D   E   F   G   H" << endl;
+    *output << "   -------------------------------" << endl;
     for (int i=7; i>=0 ; i--) {
-        cout << i+1 << " |";
+        *output << i+1 << " |";
         for (int j=0; j<8; j++) {
-            cout << " " << board[i][j] << " " << "|";
+            *output << " " << board[i][j] << " " << "|";
+        }
+        *output << " " << i+1;
+        *output << endl;
+        *output << "   -------------------------------" << endl;
+    }
+    *output << "    A   B   C   D   E   F   G   H" << endl;
+}
+
+
+
+
+/* Functions after here are for packed positions */
+
+void ChessBoard::clear_board() {
+    for (int i=0; i<8; i++) {
+        for (int j=0; j<8; j++) {
+            if (board[i][j] != NULL) {
+                delete board[i][j];
+                board[i][j] = NULL;
+            }
+        }
+    }
+}
+
+
+
+ChessPiece *ChessBoard::create_piece(int const piece_code) {
+    /* Bit 3 of the piece code marks a black chess piece, the low 3 bits the type of chess piece. */
+    char team = (piece_code & 8) ? 'b' : 'w';
+    switch (piece_code & 7) {
+        case ChessPiece::king:
+            return new KingPiece(team);
+        case ChessPiece::queen:
+            return new QueenPiece(team);
+        case ChessPiece::rook:
+            return new RookPiece(team);
+        case ChessPiece::bishop:
+            return new BishopPiece(team);
+        case ChessPiece::knight:
+            return new KnightPiece(team);
+        default:
+            return new PawnPiece(team);
+    }
+}
+
+
+
+int ChessBoard::castling_rights() const {
+    int rights = 0;
+    /* Castling is possible only while the king and the rook of that side are unmoved (which also means they are still on their starting squares). */
+    for (int side=0; side<2; side++) {
+        int rank = (side == 0) ? 0 : 7;
+        bool white_side = (side == 0);
+        ChessPiece *king_piece = board[rank][4];
+        if ((king_piece == NULL) || (king_piece->cptype != ChessPiece::king) || (king_piece->white != white_side) || (king_piece->move_counter != 0))
+            continue;
+        ChessPiece *king_rook = board[rank][7];
+        if ((king_rook != NULL) && (king_rook->cptype == ChessPiece::rook) && (king_rook->white == white_side) && (king_rook->move_counter == 0))
+            rights |= white_side ? PackedPosition::white_king_side : PackedPosition::black_king_side;
+        ChessPiece *queen_rook = board[rank][0];
+        if ((queen_rook != NULL) && (queen_rook->cptype == ChessPiece::rook) && (queen_rook->white == white_side) && (queen_rook->move_counter == 0))
+            rights |= white_side ? PackedPosition::white_queen_side : PackedPosition::black_queen_side;
+    }
+    return rights;
+}
+
+
+
+PackedPosition ChessBoard::pack() const {
+    PackedPosition position = {{0, 0, 0, 0}};
+    ChessPiece *const *squares = &board[0][0];
+    int index = 0;
+
+    /* Walk the squares in increasing order (rank * 8 + file), setting the occupancy bit and appending a nibble for every chess piece found. */
+    for (int square=0; square<64; square++) {
+        ChessPiece const *piece = squares[square];
+        if (piece == NULL)
+            continue;
+        position.words[0] |= 1ULL << square;
+        uint64_t code = piece_code(piece);
+        position.words[1 + index / 16] |= code << ((index % 16) * 4);
+        index++;
+    }
+
+    /* Fold the side to move and the castling rights into the flag word. */
+    position.words[3] = (white ? 1 : 0) | (castling_rights() << 1);
+    return position;
+}
+
+
+
+void ChessBoard::unpack(PackedPosition const &position) {
+
+    /* Delete all the existing chess pieces before placing the packed ones. */
+    clear_board();
+
+    ChessPiece **squares = &board[0][0];
+    int rights = position.castling();
+    uint64_t occupancy = position.words[0];
+    int index = 0;
+
+    while (occupancy) {
+        int square = __builtin_ctzll(occupancy);
+        occupancy &= occupancy - 1;
+        int code = (position.words[1 + index / 16] >> ((index % 16) * 4)) & 0xF;
+        index++;
+
+        ChessPiece *piece = create_piece(code);
+        squares[square] = piece;
+        int rank = square / 8, file = square % 8;
+
+        /* Restore the move counters that matter to the rules: a pawn can still move 2 squares only from its starting rank, and kings and rooks are unmoved only when they keep a castling right. */
+        switch (piece->cptype) {
+            case ChessPiece::pawn:
+                piece->move_counter = (rank == (piece->white ? 1 : 6)) ? 0 : 1;
+                break;
+            case ChessPiece::king:
+                if (piece->white) {
+                    white_kings_location[0] = rank;
+                    white_kings_location[1] = file;
+                    piece->move_counter = (rights & (PackedPosition::white_king_side | PackedPosition::white_queen_side)) ? 0 : 1;
+                }
+                else {
+                    black_kings_location[0] = rank;
+                    black_kings_location[1] = file;
+                    piece->move_counter = (rights & (PackedPosition::black_king_side | PackedPosition::black_queen_side)) ? 0 : 1;
+                }
+                break;
+            case ChessPiece::rook:
+                if ((square == 7) && (rights & PackedPosition::white_king_side))
+                    piece->move_counter = 0;
+                else if ((square == 0) && (rights & PackedPosition::white_queen_side))
+                    piece->move_counter = 0;
+                else if ((square == 63) && (rights & PackedPosition::black_king_side))
+                    piece->move_counter = 0;
+                else if ((square == 56) && (rights & PackedPosition::black_queen_side))
+                    piece->move_counter = 0;
+                else
+                    piece->move_counter = 1;
+                break;
+            default:
+                piece->move_counter = 0;
+                break;
+        }
+    }
+
+    white = position.white_to_move();
+    game_over = false;
+    refresh_incremental_state();
+    destinations_valid = false;
+    publish_snapshot();
+}
+
+
+
+/* Functions after here are for static exchange evaluation */
+
+const int ChessBoard::see_values[6] = {20000, 900, 500, 300, 300, 100};
+
+
+
+void ChessBoard::piece_bitboards(uint64_t pieces[2][6]) const {
+    for (int i=0; i<2; i++) {
+        for (int j=0; j<6; j++)
+            pieces[i][j] = 0;
+    }
+    ChessPiece *const *squares = &board[0][0];
+    for (int square=0; square<64; square++) {
+        ChessPiece const *piece = squares[square];
+        if (piece != NULL)
+            pieces[piece->white ? 0 : 1][piece->cptype] |= square_bit(square);
+    }
+}
+
+
+
+uint64_t ChessBoard::attackers_to(int const square, uint64_t const occupied, uint64_t const pieces[2][6]) {
+    uint64_t rooks_queens = pieces[0][ChessPiece::rook] | pieces[1][ChessPiece::rook] | pieces[0][ChessPiece::queen] | pieces[1][ChessPiece::queen];
+    uint64_t bishops_queens = pieces[0][ChessPiece::bishop] | pieces[1][ChessPiece::bishop] | pieces[0][ChessPiece::queen] | pieces[1][ChessPiece::queen];
+
+    /* A white pawn attacks the square if it stands where a black pawn on the square would attack, and the other way round. */
+    uint64_t attackers = (pawn_attacks(square, false) & pieces[0][ChessPiece::pawn]) | (pawn_attacks(square, true) & pieces[1][ChessPiece::pawn]);
+    attackers |= knight_attacks(square) & (pieces[0][ChessPiece::knight] | pieces[1][ChessPiece::knight]);
+    attackers |= king_attacks(square) & (pieces[0][ChessPiece::king] | pieces[1][ChessPiece::king]);
+    /* Sliding pieces are found by looking outwards from the square with the current occupancy, so removing a piece reveals the x-ray attacker behind it. */
+    attackers |= rook_attacks(square, occupied) & rooks_queens;
+    attackers |= bishop_attacks(square, occupied) & bishops_queens;
+    return attackers & occupied;
+}
+
+
+
+int ChessBoard::see(int const from_square, int const to_square) const {
+    ChessPiece *const *squares = &board[0][0];
+    ChessPiece const *moved_piece = squares[from_square];
+    if (moved_piece == NULL)
+        return 0;
+
+    uint64_t pieces[2][6];
+    piece_bitboards(pieces);
+    uint64_t occupancy = occupied;
+
+    /* gain[d] is the material balance, seen by the team making the d-th capture, if the exchange stops after that capture. */
+    int gain[32];
+    int depth = 0;
+    ChessPiece const *target_piece = squares[to_square];
+    gain[0] = (target_piece != NULL) ? see_values[target_piece->cptype] : 0;
+
+    /* Type of the chess piece currently standing on to_square, and the team to recapture next. */
+    int piece_on_square = moved_piece->cptype;
+    int team = moved_piece->white ? 1 : 0;
+    uint64_t from_bit = square_bit(from_square);
+
+    while (true) {
+        /* Take the last capturing piece off its square, then find the least valuable attacker left for the team to recapture. */
+        occupancy ^= from_bit;
+        uint64_t attackers = attackers_to(to_square, occupancy, pieces);
+        from_bit = 0;
+        int attacker_type = 0;
+        /* The cptypes enum is ordered from king to pawn, so walk it backwards for the least valuable piece first. */
+        for (int type=ChessPiece::pawn; type>=ChessPiece::king; type--) {
+            uint64_t candidates = attackers & pieces[team][type];
+            if (candidates) {
+                from_bit = candidates & (~candidates + 1);
+                attacker_type = type;
+                break;
+            }
+        }
+        if (from_bit == 0)
+            break;
+
+        depth++;
+        gain[depth] = see_values[piece_on_square] - gain[depth-1];
+        piece_on_square = attacker_type;
+        team ^= 1;
+    }
+
+    /* Each team may stop the exchange instead of recapturing, so fold the sequence back from the last capture. */
+    while (depth > 0) {
+        gain[depth-1] = -max(-gain[depth-1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
+}
+
+
+
+/* Functions after here are for the incremental state (piece key and evaluation network) */
+
+int ChessBoard::piece_code(ChessPiece const *piece) {
+    return piece->cptype | (piece->white ? 0 : 8);
+}
+
+
+
+void ChessBoard::update_added_piece(int const rank, int const file) {
+    ChessPiece const *piece = board[rank][file];
+    int square = rank * 8 + file;
+    piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+    occupied |= square_bit(square);
+    if (piece->cptype == ChessPiece::pawn) {
+        pawn_piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+        pawn_squares[piece->white ? 0 : 1] |= square_bit(square);
+    }
+    if (network != NULL)
+        network->add_feature(accumulator, ChessNetwork::feature_index(0, piece->white, piece->cptype, square), ChessNetwork::feature_index(1, piece->white, piece->cptype, square));
+}
+
+
+
+void ChessBoard::update_removed_piece(int const rank, int const file) {
+    ChessPiece const *piece = board[rank][file];
+    int square = rank * 8 + file;
+    piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+    occupied &= ~square_bit(square);
+    if (piece->cptype == ChessPiece::pawn) {
+        pawn_piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+        pawn_squares[piece->white ? 0 : 1] &= ~square_bit(square);
+    }
+    if (network != NULL)
+        network->remove_feature(accumulator, ChessNetwork::feature_index(0, piece->white, piece->cptype, square), ChessNetwork::feature_index(1, piece->white, piece->cptype, square));
+}
+
+
+
+void ChessBoard::refresh_incremental_state() {
+    piece_key = 0;
+    occupied = 0;
+    pawn_piece_key = 0;
+    pawn_squares[0] = 0;
+    pawn_squares[1] = 0;
+    ChessPiece *const *all_squares = &board[0][0];
+    for (int square=0; square<64; square++) {
+        ChessPiece const *piece = all_squares[square];
+        if (piece != NULL) {
+            piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+            occupied |= square_bit(square);
+            if (piece->cptype == ChessPiece::pawn) {
+                pawn_piece_key ^= POSITION_KEYS.pieces[piece_code(piece)][square];
+                pawn_squares[piece->white ? 0 : 1] |= square_bit(square);
+            }
         }
-        cout << " " << i+1;
-        cout << endl;
-        cout << "   -------------------------------" << endl;
     }
-    cout << "    A   B   C   D   E   F   G   H" << endl;
+
+    if (network == NULL)
+        return;
+
+    /* Collect the features of every chess piece for both perspectives before recomputing the accumulator. */
+    int features[2][32];
+    int count = 0;
+    ChessPiece *const *squares = &board[0][0];
+    for (int square=0; (square<64) && (count<32); square++) {
+        ChessPiece const *piece = squares[square];
+        if (piece == NULL)
+            continue;
+        features[0][count] = ChessNetwork::feature_index(0, piece->white, piece->cptype, square);
+        features[1][count] = ChessNetwork::feature_index(1, piece->white, piece->cptype, square);
+        count++;
+    }
+    network->refresh(accumulator, features, count);
+}
+
+
+
+void ChessBoard::attach_network(ChessNetwork const *chess_network) {
+    network = chess_network;
+    refresh_incremental_state();
+}
+
+
+
+bool ChessBoard::attach_feed(MoveFeed *move_feed, uint32_t const game) {
+    /* The game indexes the table of game snapshots in the shared memory, so a game past its end would write into memory other processes map. */
+    if ((move_feed != NULL) && (!move_feed->opened() || (game >= move_feed->game_count())))
+        return false;
+    feed = move_feed;
+    feed_game = game;
+    publish_snapshot();
+    return true;
+}
+
+
+
+int ChessBoard::evaluate(PawnTable *pawn_table) const {
+    if (network == NULL)
+        return material_evaluation(pawn_table);
+    return network->evaluate(accumulator, white);
+}
+
+
+
+PawnScore ChessBoard::pawn_score(PawnTable *pawn_table) const {
+    int white_king = white_kings_location[0] * 8 + white_kings_location[1];
+    int black_king = black_kings_location[0] * 8 + black_kings_location[1];
+    if (pawn_table == NULL)
+        return PawnTable::evaluate(pawn_squares[0], pawn_squares[1], white_king, black_king);
+    return pawn_table->probe(pawn_piece_key, pawn_squares[0], pawn_squares[1], white_king, black_king);
+}
+
+
+
+uint64_t ChessBoard::pawn_key() const {
+    return pawn_piece_key;
+}
+
+
+
+int ChessBoard::material_evaluation(PawnTable *pawn_table) const {
+    int score = 0;
+    for (int i=0; i<8; i++) {
+        for (int j=0; j<8; j++) {
+            ChessPiece const *piece = board[i][j];
+            if ((piece == NULL) || (piece->cptype == ChessPiece::king))
+                continue;
+            /* Material, plus a bonus for knights and bishops near the centre and for pawns advancing. */
+            int value = see_values[piece->cptype];
+            if ((piece->cptype == ChessPiece::knight) || (piece->cptype == ChessPiece::bishop))
+                value += 12 - 3 * (max(abs(2 * i - 7), abs(2 * j - 7)) / 2);
+            else if (piece->cptype == ChessPiece::pawn)
+                value += 4 * (piece->white ? i - 1 : 6 - i);
+            score += piece->white ? value : -value;
+        }
+    }
+    PawnScore pawns = pawn_score(pawn_table);
+    score += pawns.structure + pawns.shield;
+    return white ? score : -score;
+}
+
+
+
+int ChessBoard::piece_at(int const square) const {
+    ChessPiece const *piece = board[square / 8][square % 8];
+    return (piece == NULL) ? -1 : piece_code(piece);
+}
+
+
+
+bool ChessBoard::white_to_move() const {
+    return white;
+}
+
+
+
+bool ChessBoard::in_check() const {
+    int king_square = white ? white_kings_location[0] * 8 + white_kings_location[1] : black_kings_location[0] * 8 + black_kings_location[1];
+    return square_attacked(king_square, !white);
+}
+
+
+
+bool ChessBoard::is_legal(int const from, int const to) const {
+    if ((from < 0) || (from >= 64) || (to < 0) || (to >= 64))
+        return false;
+    return move_legal(ChessMove{uint8_t(from), uint8_t(to)});
+}
+
+
+
+bool ChessBoard::gives_check(int const from, int const to) const {
+    if (!is_legal(from, to))
+        return false;
+    int opponent_king_square = white ? black_kings_location[0] * 8 + black_kings_location[1] : white_kings_location[0] * 8 + white_kings_location[1];
+    ChessPiece const *piece = board[from / 8][from % 8];
+
+    /* Castling moves the rook as well. Only the rook can give check then: the king and rook leave squares on their own back rank, with nothing behind them to uncover. */
+    if ((piece->cptype == ChessPiece::king) && (abs(to % 8 - from % 8) == 2)) {
+        int rank = from / 8;
+        int rook_from = rank * 8 + ((to > from) ? 7 : 0), rook_to = (to > from) ? to - 1 : to + 1;
+        uint64_t occupancy = (occupied & ~square_bit(from) & ~square_bit(rook_from)) | square_bit(to) | square_bit(rook_to);
+        return (rook_attacks(rook_to, occupancy) & square_bit(opponent_king_square)) != 0;
+    }
+
+    /* Look for attackers of the other king as if the move was made, which finds the moved chess piece on its new square and any line it opened. */
+    return square_attacked(opponent_king_square, white, from, to);
+}
+
+
+
+/* Functions after here are for move generation */
+
+uint64_t ChessBoard::position_key() const {
+    uint64_t key = piece_key ^ POSITION_KEYS.castling[castling_rights()];
+    if (white)
+        key ^= POSITION_KEYS.white_to_move;
+    return key;
+}
+
+
+
+bool ChessBoard::square_attacked(int const square, bool const by_white, int const vacated, int const filled) const {
+    ChessPiece *const *board_squares = &board[0][0];
+    /* Chess piece on a square as if the chess piece on vacated had moved to filled. */
+    auto piece_on = [&](int const target) -> ChessPiece const * {
+        if (target == vacated)
+            return NULL;
+        return (target == filled) ? board_squares[vacated] : board_squares[target];
+    };
+    /* Pawns attack diagonally forwards, so the attacking pawns stand on the squares a pawn of the other team on the square would attack. */
+    uint64_t pawns = pawn_attacks(square, !by_white);
+    while (pawns) {
+        ChessPiece const *piece = piece_on(lowest_square(pawns));
+        pawns &= pawns - 1;
+        if ((piece != NULL) && (piece->cptype == ChessPiece::pawn) && (piece->white == by_white))
+            return true;
+    }
+
+    /* Knights and kings attack a fixed set of squares around them. */
+    uint64_t knights = knight_attacks(square), kings = king_attacks(square);
+    while (knights) {
+        ChessPiece const *piece = piece_on(lowest_square(knights));
+        knights &= knights - 1;
+        if ((piece != NULL) && (piece->cptype == ChessPiece::knight) && (piece->white == by_white))
+            return true;
+    }
+    while (kings) {
+        ChessPiece const *piece = piece_on(lowest_square(kings));
+        kings &= kings - 1;
+        if ((piece != NULL) && (piece->cptype == ChessPiece::king) && (piece->white == by_white))
+            return true;
+    }
+
+    /* Sliding pieces: look up the squares a rook and a bishop on the square would attack with the occupancy after the move. The first chess piece on each line is among them, and attacks the square if it is a rook or queen (straight lines) or a bishop or queen (diagonal lines) of the attacking team. */
+    uint64_t occupancy = occupied;
+    if ((vacated >= 0) && (filled >= 0))
+        occupancy = (occupancy & ~square_bit(vacated)) | square_bit(filled);
+    for (int diagonal=0; diagonal<2; diagonal++) {
+        uint64_t blockers = (diagonal ? bishop_attacks(square, occupancy) : rook_attacks(square, occupancy)) & occupancy;
+        while (blockers) {
+            ChessPiece const *piece = piece_on(lowest_square(blockers));
+            blockers &= blockers - 1;
+            if ((piece != NULL) && (piece->white == by_white)) {
+                int type = piece->cptype;
+                if ((type == ChessPiece::queen) || (type == (diagonal ? ChessPiece::bishop : ChessPiece::rook)))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+
+bool ChessBoard::king_safe_after(int const from, int const to) const {
+    int king_square = white ? white_kings_location[0] * 8 + white_kings_location[1] : black_kings_location[0] * 8 + black_kings_location[1];
+    if (from == king_square)
+        king_square = to;
+
+    /* Look for attackers of the own king as if the move was made. */
+    return !square_attacked(king_square, !white, from, to);
+}
+
+
+
+int ChessBoard::legal_moves(ChessMove *moves) const {
+    ChessPiece *const *squares = &board[0][0];
+    int count = 0;
+
+    /* Split the occupied squares between both teams. */
+    uint64_t occupancy = occupied, own = 0;
+    for (uint64_t rest=occupancy; rest!=0; rest&=rest-1) {
+        int square = lowest_square(rest);
+        if (squares[square]->white == white)
+            own |= square_bit(square);
+    }
+    uint64_t opponent = occupancy & ~own;
+
+    /* Find the destination squares of every own chess piece from its movement logic, then keep the moves that do not leave the own king in check. */
+    uint64_t pieces = own;
+    while (pieces) {
+        int from = lowest_square(pieces);
+        pieces &= pieces - 1;
+        ChessPiece const *piece = squares[from];
+        uint64_t targets = 0;
+
+        switch (piece->cptype) {
+            case ChessPiece::king:
+                targets = king_attacks(from);
+                break;
+            case ChessPiece::queen:
+                targets = rook_attacks(from, occupancy) | bishop_attacks(from, occupancy);
+                break;
+            case ChessPiece::rook:
+                targets = rook_attacks(from, occupancy);
+                break;
+            case ChessPiece::bishop:
+                targets = bishop_attacks(from, occupancy);
+                break;
+            case ChessPiece::knight:
+                targets = knight_attacks(from);
+                break;
+            case ChessPiece::pawn: {
+                /* Pawns capture diagonally forwards, and move forwards 1 square (or 2 on their first move) onto empty squares only. There is no promotion, so a pawn on the last rank cannot move forwards. */
+                targets = pawn_attacks(from, white) & opponent;
+                int step = white ? 8 : -8;
+                int one = from + step;
+                if ((one >= 0) && (one < 64) && !(occupancy & square_bit(one))) {
+                    targets |= square_bit(one);
+                    int two = one + step;
+                    if ((piece->move_counter == 0) && (two >= 0) && (two < 64) && !(occupancy & square_bit(two)))
+                        targets |= square_bit(two);
+                }
+                break;
+            }
+        }
+        targets &= ~own;
+
+        while (targets) {
+            int to = lowest_square(targets);
+            targets &= targets - 1;
+            if (king_safe_after(from, to)) {
+                moves[count].from = from;
+                moves[count].to = to;
+                count++;
+            }
+        }
+    }
+
+    /* Castling uses the same checks as submitMove(): the king and the rook are unmoved, the squares between them are empty and the king is not in check on any square from its starting to its final square. */
+    int king_rank = white ? white_kings_location[0] : black_kings_location[0];
+    int king_file = white ? white_kings_location[1] : black_kings_location[1];
+    if (board[king_rank][king_file]->move_counter == 0) {
+        for (int new_king_file=king_file-2; new_king_file<=king_file+2; new_king_file+=4) {
+            if ((new_king_file < 0) || (new_king_file > 7))
+                continue;
+            if (castling_obstruction_check(king_file, new_king_file, king_rank) && castling_rook_check(king_file, new_king_file, king_rank) && castling_king_check(king_file, new_king_file, king_rank)) {
+                moves[count].from = king_rank * 8 + king_file;
+                moves[count].to = king_rank * 8 + new_king_file;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+
+
+void ChessBoard::make(ChessMove const &move, ChessMoveUndo &undo) {
+    int old_rank = move.from / 8, old_file = move.from % 8, new_rank = move.to / 8, new_file = move.to % 8;
+    ChessPiece *piece = board[old_rank][old_file];
+
+    /* Lift the captured piece (kept for unmake()) and the moved piece off the board. */
+    undo.captured = board[new_rank][new_file];
+    if (undo.captured != NULL)
+        update_removed_piece(new_rank, new_file);
+    update_removed_piece(old_rank, old_file);
+    board[new_rank][new_file] = piece;
+    board[old_rank][old_file] = NULL;
+    piece->move_counter++;
+    update_added_piece(new_rank, new_file);
+
+    /* Follow the king, and move the rook as well when castling. */
+    undo.castling = false;
+    if (piece->cptype == ChessPiece::king) {
+        int *location = piece->white ? white_kings_location : black_kings_location;
+        location[0] = new_rank;
+        location[1] = new_file;
+        if (abs(new_file - old_file) == 2) {
+            undo.castling = true;
+            int rook_from = (new_file > old_file) ? 7 : 0, rook_to = (new_file > old_file) ? 5 : 3;
+            update_removed_piece(old_rank, rook_from);
+            board[old_rank][rook_to] = board[old_rank][rook_from];
+            board[old_rank][rook_from] = NULL;
+            board[old_rank][rook_to]->move_counter++;
+            update_added_piece(old_rank, rook_to);
+        }
+    }
+    white = !white;
+    destinations_valid = false;
+}
+
+
+
+void ChessBoard::unmake(ChessMove const &move, ChessMoveUndo const &undo) {
+    int old_rank = move.from / 8, old_file = move.from % 8, new_rank = move.to / 8, new_file = move.to % 8;
+    ChessPiece *piece = board[new_rank][new_file];
+    white = !white;
+
+    /* Put the rook back first when the move was castling. */
+    if (undo.castling) {
+        int rook_from = (new_file > old_file) ? 7 : 0, rook_to = (new_file > old_file) ? 5 : 3;
+        update_removed_piece(old_rank, rook_to);
+        board[old_rank][rook_from] = board[old_rank][rook_to];
+        board[old_rank][rook_to] = NULL;
+        board[old_rank][rook_from]->move_counter--;
+        update_added_piece(old_rank, rook_from);
+    }
+    if (piece->cptype == ChessPiece::king) {
+        int *location = piece->white ? white_kings_location : black_kings_location;
+        location[0] = old_rank;
+        location[1] = old_file;
+    }
+
+    /* Move the piece back and restore the captured piece. */
+    update_removed_piece(new_rank, new_file);
+    board[old_rank][old_file] = piece;
+    board[new_rank][new_file] = undo.captured;
+    piece->move_counter--;
+    update_added_piece(old_rank, old_file);
+    if (undo.captured != NULL)
+        update_added_piece(new_rank, new_file);
+    destinations_valid = false;
+}
+
+
+
+void ChessBoard::discard_undo(ChessMoveUndo const &undo) {
+    delete undo.captured;
+}
+
+
+
+void ChessBoard::play(ChessMove const &move) {
+    ChessMoveUndo undo;
+    make(move, undo);
+    delete undo.captured;
+    publish_snapshot();
+}
+
+
+
+void ChessBoard::publish_snapshot() {
+    FeedDelta delta = {feed_game, 0, 0, FEED_NO_CAPTURE, FEED_POSITION};
+    publish_snapshot(delta);
+}
+
+
+
+void ChessBoard::publish_snapshot(FeedDelta const &delta) {
+    PackedPosition position = pack();
+    snapshot.publish(position, game_over);
+    if (feed != NULL)
+        feed->publish(delta, position, game_over);
+}
+
+
+
+BoardSnapshot ChessBoard::read_snapshot() const {
+    return snapshot.read();
+}
+
+
+
+uint64_t ChessBoard::legal_destinations(int const square) {
+    if (!destinations_valid) {
+        /* Group the legal moves of the position by their source square. */
+        ChessMove moves[MAX_MOVES];
+        int count = legal_moves(moves);
+        for (int i=0; i<64; i++)
+            destinations[i] = 0;
+        for (int i=0; i<count; i++)
+            destinations[moves[i].from] |= square_bit(moves[i].to);
+        destinations_valid = true;
+    }
+    return destinations[square];
+}
+
+
+bool ChessBoard::move_legal(ChessMove const &move) const {
+    if ((move.from >= 64) || (move.to >= 64))
+        return false;
+    int old_rank = move.from / 8, old_file = move.from % 8, new_rank = move.to / 8, new_file = move.to % 8;
+    ChessPiece const *piece = board[old_rank][old_file];
+    if ((piece == NULL) || (piece->white != white))
+        return false;
+
+    /* An unmoved king going 2 squares along its rank castles, with the same checks as submitMove(). */
+    if ((piece->cptype == ChessPiece::king) && (piece->move_counter == 0) && (old_rank == new_rank) && (abs(old_file - new_file) == 2))
+        return castling_obstruction_check(old_file, new_file, old_rank) && castling_rook_check(old_file, new_file, old_rank) && castling_king_check(old_file, new_file, old_rank);
+    return piece->valid_move(old_rank, old_file, new_rank, new_file, *this) && king_safe_after(move.from, move.to);
+}
+
+
+
+size_t ChessBoard::submitMoves(ChessMove const *moves, size_t const count) {
+    size_t played = 0;
+    if (!game_over) {
+        for (; played<count; played++) {
+            if (!move_legal(moves[played]))
+                break;
+            ChessMoveUndo undo;
+            make(moves[played], undo);
+            delete undo.captured;
+        }
+    }
+
+    /* The status is only looked at once, for the position the sequence ends in. */
+    GameStatus status = game_status();
+    if ((status == game_checkmate) || (status == game_stalemate))
+        game_over = true;
+    publish_snapshot();
+    return played;
+}
+
+
+
+GameStatus ChessBoard::game_status() const {
+    /* Use the moves cached for legal_destinations() if the position has not changed since, otherwise generate them without caching them. */
+    bool movable = false;
+    if (destinations_valid) {
+        for (int square=0; square<64; square++)
+            movable = movable || (destinations[square] != 0);
+    }
+    else {
+        ChessMove moves[MAX_MOVES];
+        movable = legal_moves(moves) > 0;
+    }
+    bool check = in_check();
+    if (!movable)
+        return check ? game_checkmate : game_stalemate;
+    return check ? game_check : game_in_progress;
+}
+
+
+
+void ChessBoard::set_output(ostream *messages, ostream *error_messages) {
+    output = messages;
+    errors = error_messages;
 }
@@ -2,13 +2,46 @@
 #define CHESSBOARD_H
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include "ChessPieces.h"
+#include "ChessPosition.h"
+#include "ChessBitboard.h"
+#include "ChessNetwork.h"
+#include "ChessPawns.h"
+#include "ChessSnapshot.h"
 
 using namespace std;
 
 class ChessPiece;
+class MoveFeed;
+struct FeedDelta;
 
+/* Upper bound on the number of legal moves in a position, for move arrays. */
+const int MAX_MOVES = 256;
+
+/* A move from one square to another, squares numbered rank * 8 + file as in PackedPosition. A king moving 2 squares along its rank is a castling move. */
+struct ChessMove {
+    uint8_t from;
+    uint8_t to;
+};
+
+inline bool operator==(ChessMove const &lhs, ChessMove const &rhs) {
+    return (lhs.from == rhs.from) && (lhs.to == rhs.to);
+}
+
+/* Status of the game for the team to move (see ChessBoard::game_status()). */
+enum GameStatus {game_in_progress, game_check, game_checkmate, game_stalemate};
+
+/* Everything unmake() needs to take back a move made with make(). */
+struct ChessMoveUndo {
+    /* The captured chess piece (NULL if none), kept alive until the move is taken back. */
+    ChessPiece *captured;
+    /* True if the move was castling (the rook was moved as well). */
+    bool castling;
+};
+
+/* Boards share no mutable state: different boards can be used by different threads at the same time, each writing its messages to its own streams (see set_output()). On one board, const methods (e.g. is_legal() and gives_check()) may run concurrently with each other, and read_snapshot() with anything, but the other methods (including legal_destinations(), which fills a cache) need the board to themselves. */
 class ChessBoard {
     /* All piece types is made friend class of the ChessBoard class to access the board's current configuration as it needs to check (e.g. for obstruction) when moving. */
     friend class ChessPiece;
@@ -37,13 +70,42 @@ class ChessBoard {
         /* Store the state of the game */
         bool game_over;
 
+        /* Evaluation network attached to the board (NULL if none), and its first layer output for the current position which make_move() and make_castling_move() keep up to date. */
+        ChessNetwork const *network;
+        NetworkAccumulator accumulator;
+
+        /* Xor of the Zobrist keys of every chess piece on its square, kept up to date by every move so position_key() does not have to look at the whole board. */
+        uint64_t piece_key;
+
+        /* Xor of the Zobrist keys of the pawns only, and the squares of the pawns of each team ([0] white, [1] black), kept up to date by every move for the pawn structure evaluation (see pawn_key()). */
+        uint64_t pawn_piece_key;
+        uint64_t pawn_squares[2];
+
+        /* Squares holding a chess piece, kept up to date by every move and by temp_make_move() and undo_temp_move(), for the sliding attack lookups. */
+        uint64_t occupied;
+
+        /* Legal destination squares of the chess piece on each square for the current position, computed all at once by the first legal_destinations() call and valid until the board changes. */
+        uint64_t destinations[64];
+        bool destinations_valid;
+
+        /* Streams the messages of the board are written to (NULL for none), see set_output(). */
+        ostream *output;
+        ostream *errors;
+
+        /* Position published for other threads after every completed move (see read_snapshot()). */
+        SnapshotPublisher snapshot;
+
+        /* Move feed the accepted moves are broadcast to (NULL for none) and the game they belong to in it, see attach_feed(). */
+        MoveFeed *feed;
+        uint32_t feed_game;
+
         /* Methods of chess board is declared in this section */
 
         /* A function that checks if the new and old position, for the destination and source sqaure positions submitted respectively, is a valid position.
         @param old_position: string representing the source square.
         @param new_position: string representing the destination square.
         @return true if both old_position and new_position passes the above checks, false otherwise. */
-        bool check_valid_str_position(string const old_position, string const new_position) const;
+        bool check_valid_str_position(string_view const old_position, string_view const new_position) const;
         
         /* Check if all opponent's pieces can move to the king piece position, who's rank and file is passed into the function as parameters.
         @param: king_rank, king_file: the rank and file of the king piece we are looking to check if the other team is able to reach respectively.
@@ -95,7 +157,7 @@ class ChessBoard {
         @param: new_king_file: the file to be moved to by the king
         @param: king_rank: which is the rank of the king (either 1 or 8) 
         return true if the king passes the check and will not be in check, false otherwise */
-        bool castling_king_check(int const old_king_file, int const new_king_file, int const king_rank);
+        bool castling_king_check(int const old_king_file, int const new_king_file, int const king_rank) const;
 
         /* Perform all checks to see if the castling move is valid
         @param: old_king_file: the original file of the king
@@ -107,14 +169,89 @@ class ChessBoard {
         Function also prints out a unique message for castling */
         void make_castling_move(int const old_rank, int const old_file, int const new_rank, int const new_file);
 
+        /* Function that deletes every chess piece on the board and sets all squares to NULL. */
+        void clear_board();
+
+        /* Function that constructs a new chess piece from a piece code of PackedPosition.
+        @param piece_code: the piece code (see PackedPosition::piece_codes).
+        @return the newly constructed chess piece. */
+        static ChessPiece *create_piece(int const piece_code);
+
+        /* Function that works out the castling rights of the current position from the move counters of the kings and rooks.
+        @return the castling rights as a combination of PackedPosition::castling_rights. */
+        int castling_rights() const;
+
+        /* Piece values in centipawns used by the static exchange evaluation, indexed by the type of chess piece (same order as ChessPiece's cptypes enum). */
+        static const int see_values[6];
+
+        /* Function that collects the squares of every chess piece into bitboards.
+        @param pieces: filled with one bitboard per team ([0] white, [1] black) and type of chess piece. */
+        void piece_bitboards(uint64_t pieces[2][6]) const;
+
+        /* Function that finds every chess piece (of both teams) attacking a square, looking through the squares that are not in occupied (i.e. pieces already removed from an exchange).
+        @param square: the square being attacked.
+        @param occupied: the squares still occupied.
+        @param pieces: bitboards from piece_bitboards().
+        @return the squares of the attackers still in occupied. */
+        static uint64_t attackers_to(int const square, uint64_t const occupied, uint64_t const pieces[2][6]);
+
+        /* Functions that keep the incremental state (piece key and network accumulator) in step with the board when the chess piece standing on a square is added there or is about to be removed from there.
+        @param rank, file: the square of the chess piece. */
+        void update_added_piece(int const rank, int const file);
+        void update_removed_piece(int const rank, int const file);
+
+        /* Function that scores the position by material, simple piece placement terms and the pawn score (used by evaluate() when no network is attached).
+        @return the score in centipawns for the team whose turn it is. */
+        int material_evaluation(PawnTable *pawn_table) const;
+
+        /* Function that recomputes the piece key and the network accumulator (if a network is attached) from every chess piece on the board. */
+        void refresh_incremental_state();
+
+        /* Function that publishes the current position and game state as the board's snapshot. Called only once a move is complete (never from the simulated moves used to validate a move or generate moves). */
+        void publish_snapshot();
+
+        /* Function that publishes the snapshot, and the delta of a move accepted by submitMove() to the attached feed (publish_snapshot() sends a FEED_POSITION delta instead). */
+        void publish_snapshot(FeedDelta const &delta);
+
+        /* Return the piece code of a chess piece (see PackedPosition::piece_codes). */
+        static int piece_code(ChessPiece const *piece);
+
+        /* Function that checks if a square is attacked by any chess piece of a team, looking outwards from the square on the board (same rules as check_king_test()).
+        @param square: the square (rank * 8 + file).
+        @param by_white: true to look for white attackers, false for black attackers.
+        @param vacated, filled: if given, the board is looked at as if the chess piece on vacated had moved to filled (without changing it).
+        @return true if the square is attacked. */
+        bool square_attacked(int const square, bool const by_white, int const vacated = -1, int const filled = -1) const;
+
+        /* Function that checks if a normal (non castling) move of the team to move would leave its own king in check, looking at the board as if the move was made (without changing it).
+        @return true if the own king is safe after the move. */
+        bool king_safe_after(int const from, int const to) const;
+
+        /* Function that checks silently if a move of the team to move is legal, following the same rules as submitMove() (castling included).
+        @return true if the move is legal. */
+        bool move_legal(ChessMove const &move) const;
+
     public:
         /* Default constructor that constructs the board and instantiate all chess pieces, at their default position, and variables such that it indicated white team making the first move, followed by printing out the game start message. */
         ChessBoard();
+
+        /* Constructor that sets up the board from a packed position without printing the game start message (used for bulk processing of stored positions).
+        @param position: the packed position to set up the board from. */
+        explicit ChessBoard(PackedPosition const &position);
+
+        /* Copy constructor and assignment that duplicate every chess piece, so each copy can be used (e.g. by its own thread) independently. */
+        ChessBoard(ChessBoard const &other);
+        ChessBoard &operator=(ChessBoard const &other);
        
         /* Method which conducts the following multiple checks on the input and move validity before making the move submitted officially.
         If the move passes all checks, check if the current move will result in a check, checkmate, stalemate or should the game continue as per normal.
         @return: method returns nothing. However, update will only be done on the baord if the current move is valid.  */
-        void submitMove(string const old_position, string const new_position);
+        void submitMove(string_view const old_position, string_view const new_position);
+
+        /* Method that submits a sequence of moves silently, e.g. to replay a stored game. Every move is checked for legality as in submitMove(), but check, checkmate and stalemate are only worked out once, for the position reached at the end (see game_status()), which marks the game as over if it is checkmate or stalemate.
+        @param moves, count: the moves to play in order.
+        @return the number of moves played, less than count if a move is illegal (the moves after it are not played) or the game is already over. */
+        size_t submitMoves(ChessMove const *moves, size_t const count);
        
         /* Function resets the board by deleting existing chess pieces, setting all new chess pieces at their original positions and set all variables of the ChessBoard class to their initial values. */
         void resetBoard();
@@ -124,6 +261,102 @@ class ChessBoard {
 
         /* Not for marking: Method that prints out the board for visualisation and debugging. */
         void print_board() const ;
+
+        /* Method that encodes the current position (pieces, side to move and castling rights) into the canonical 32-byte PackedPosition.
+        @return the packed position. */
+        PackedPosition pack() const;
+
+        /* Method that replaces the current position by a packed position, deleting the existing chess pieces. No message is printed and the game is no longer marked as over.
+        @param position: a packed position created by pack(). */
+        void unpack(PackedPosition const &position);
+
+        /* Static exchange evaluation of moving the chess piece on from_square to to_square, resolving the whole sequence of captures on to_square with the least valuable attacker first (including x-ray attackers behind sliding pieces). The board is not changed, so it can be used both to flag hanging pieces and bad captures and to order moves.
+        @param from_square, to_square: squares numbered rank * 8 + file (e.g. E4 is 28), as in PackedPosition.
+        @return the material won (positive) or lost (negative) in centipawns by the team of the moving piece, or 0 if from_square is empty. */
+        int see(int const from_square, int const to_square) const;
+
+        /* Method that attaches an evaluation network to the board and computes its accumulator for the current position. From then on every move made updates the accumulator incrementally.
+        @param chess_network: a network with weights loaded, or NULL to detach the current one. The network must outlive the board. */
+        void attach_network(ChessNetwork const *chess_network);
+
+        /* Method that attaches a move feed to the board: from then on every move accepted by submitMove() is published to it as a delta (with the resulting game status), and every other change of position (reset, unpack(), play(), assignment) as a FEED_POSITION delta, along with the game's snapshot. Copies of the board are not attached.
+        @param move_feed: a created feed, or NULL to detach the current one. The feed must outlive the board, and only one thread at a time may publish to it.
+        @param game: the game of the feed the board plays, less than move_feed->game_count().
+        @return false, leaving the board as it was, if the feed is not created or has no such game. */
+        bool attach_feed(MoveFeed *move_feed, uint32_t const game);
+
+        /* Method that returns the 64-bit Zobrist key of the current position (pieces, side to move and castling rights), equal to pack().key(). */
+        uint64_t position_key() const;
+
+        /* Method that generates every legal move of the team to move, following the same rules as submitMove() (castling included). The board is not changed.
+        @param moves: array of at least MAX_MOVES moves to fill.
+        @return the number of legal moves. */
+        int legal_moves(ChessMove *moves) const;
+
+        /* Methods that make and take back a legal move silently (no message, no check for the game status), keeping the position key and network accumulator up to date. Moves must be taken back in reverse order.
+        @param move: a legal move from legal_moves().
+        @param undo: filled by make() and passed back to unmake() for the same move. */
+        void make(ChessMove const &move, ChessMoveUndo &undo);
+        void unmake(ChessMove const &move, ChessMoveUndo const &undo);
+
+        /* Method that frees the captured chess piece kept by an undo whose move will not be taken back (e.g. when the board is set to another position with unpack() instead).
+        @param undo: filled by make(), not passed to unmake() afterwards. */
+        static void discard_undo(ChessMoveUndo const &undo);
+
+        /* Method that plays a legal move silently and for good, like make() but deleting the captured chess piece as no unmake() will follow (e.g. to replay stored games).
+        @param move: a legal move from legal_moves(). */
+        void play(ChessMove const &move);
+
+        /* Method that evaluates the current position with the attached network, or by material, piece placement and pawn structure if no network is attached.
+        @param pawn_table: the table pawn_score() uses, or NULL (the score is the same either way).
+        @return the score in centipawns for the team whose turn it is. */
+        int evaluate(PawnTable *pawn_table = NULL) const;
+
+        /* Method that scores the pawn structure and king pawn shields of the current position (part of the evaluation without a network).
+        @param pawn_table: a table to look the score up in and store it to (its thread's own), or NULL to work it out.
+        @return the score in centipawns for white. */
+        PawnScore pawn_score(PawnTable *pawn_table = NULL) const;
+
+        /* Method that returns the 64-bit Zobrist key of the pawns of the current position, which changes only when a pawn moves or is captured. */
+        uint64_t pawn_key() const;
+
+        /* Return the piece code (see PackedPosition::piece_codes) of the chess piece on a square, or -1 if the square is empty.
+        @param square: the square (rank * 8 + file). */
+        int piece_at(int const square) const;
+
+        /* @return true if it is white's turn. */
+        bool white_to_move() const;
+
+        /* @return true if the king of the team to move is in check. */
+        bool in_check() const;
+
+        /* Method that checks if a move of the team to move is legal, following the same rules as submitMove() (castling included). The answer is worked out from the board as it stands, without simulating the move on it, so any number of threads may ask at once (see the note on ChessBoard).
+        @param from, to: the source and destination squares (rank * 8 + file).
+        @return true if the move is legal. */
+        bool is_legal(int const from, int const to) const;
+
+        /* Method that checks if a move of the team to move would put the king of the other team in check, directly or by uncovering a line, without changing the board (like is_legal()).
+        @param from, to: the source and destination squares (rank * 8 + file).
+        @return true if the move is legal and gives check. */
+        bool gives_check(int const from, int const to) const;
+
+        /* Method that returns the squares the chess piece on a square can legally move to, e.g. to highlight them when a player picks up the piece. The destinations of every square are generated together on the first call after the board changes, so further calls for the same position only read a cached value. The board is not changed.
+        @param square: the square (rank * 8 + file).
+        @return the bitboard of destination squares, 0 if the square is empty or holds a chess piece of the team not to move. */
+        uint64_t legal_destinations(int const square);
+
+        /* Method that works out the status of the game for the team to move from its legal moves (read from the legal_destinations() cache if it is up to date). The board is not changed.
+        @return whether the team to move is in check, checkmated or stalemated. */
+        GameStatus game_status() const;
+
+        /* Method that sets the streams the messages of submitMove(), resetBoard() and print_board() are written to, instead of cout and cerr. Copies of the board write to the same streams.
+        @param messages: stream for the moves, checks and rejected moves, or NULL for no messages.
+        @param error_messages: stream for the errors (e.g. no piece on the source square), or NULL for no messages. */
+        void set_output(ostream *messages, ostream *error_messages);
+
+        /* Method that returns the position as it was after the last completed move (or reset, unpack or play()). It may be called from any number of threads while one thread submits moves: it never blocks that thread, and never shows the intermediate states the board goes through while a move is validated or while make() and unmake() are used.
+        @return the last published snapshot. */
+        BoardSnapshot read_snapshot() const;
 };
 
 #endif
\ No newline at end of file
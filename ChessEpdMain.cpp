@@ -0,0 +1,241 @@
+#include "ChessBoard.h"
+#include "ChessMateSolver.h"
+#include "ChessPerft.h"
+#include "ChessSan.h"
+#include "ChessSearch.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* EPD test suite runner: checks standalone positions against the results expected by their EPD operations.
+Usage: epd <EPD file> [-t threads] [-d search depth] [-H hash megabytes per thread] [-n mate node limit]
+Each line of the file holds the 4 position fields of EPD (piece placement, side to move, castling, en passant square, the last one ignored as the rules have no en passant) followed by operations "opcode operands;". The operations checked are:
+    D<n> <count>        the number of leaf nodes of the legal move tree at depth n, as perft counts them (D1: the number of legal moves)
+    status <name>       the game status of the position: none, check, checkmate or stalemate
+    dm <n>              the team to move mates in n moves and not fewer, proven with the mate solver within the node limit
+    bm <moves>          a search of the -d depth plays one of the moves (in SAN); skipped without -d
+    am <moves>          a search of the -d depth plays none of the moves; skipped without -d
+Other operations (id, c0, ...) are ignored, as are empty lines and lines starting with '#'. Every position is loaded straight into a board from its fields, without replaying moves. Lines are spread over a thread pool, every worker with its own search and mate solver tables, and the results are printed in file order with their times, followed by the number of positions checked per second. The exit code is 1 if a check failed or a position could not be read. */
+
+struct EpdLine {
+    int line;
+    string position;
+    vector<string> operations;
+    bool valid;
+    int checks;
+    int skipped;
+    /* Description of each failed operation, empty if all passed. */
+    string failures;
+    double seconds;
+};
+
+/* Names of the GameStatus values in the "status" operation. */
+static const char *const STATUS_NAMES[4] = {"none", "check", "checkmate", "stalemate"};
+
+static void usage() {
+    cerr << "Usage: epd <EPD file> [-t threads] [-d search depth] [-H hash megabytes per thread] [-n mate node limit]" << endl;
+}
+
+/* Split an EPD line into its 4 position fields and its operations (without their ';').
+@return false if the line has fewer than 4 fields. */
+static bool split_line(string const &text, EpdLine &line) {
+    istringstream fields(text);
+    string field;
+    for (int i=0; i<4; i++) {
+        if (!(fields >> field))
+            return false;
+        line.position += (i > 0) ? " " + field : field;
+    }
+    string rest, operation;
+    getline(fields, rest);
+    istringstream operations(rest);
+    while (getline(operations, operation, ';')) {
+        size_t first = operation.find_first_not_of(" \t\r");
+        if (first != string::npos)
+            line.operations.push_back(operation.substr(first, operation.find_last_not_of(" \t\r") - first + 1));
+    }
+    return true;
+}
+
+/* Tables of one worker, allocated by its first line that needs them. */
+struct WorkerTables {
+    unique_ptr<ChessSearch> search;
+    unique_ptr<MateSolver> solver;
+};
+
+/* Run the operations of one line, recording the failures. */
+static void check_line(EpdLine &line, WorkerTables &tables, int const search_depth, size_t const hash_megabytes, uint64_t const node_limit) {
+    auto begin = chrono::steady_clock::now();
+    PackedPosition position;
+    line.valid = PackedPosition::from_fen(line.position, position);
+    if (!line.valid)
+        return;
+    ChessBoard board(position);
+    board.set_output(NULL, NULL);
+
+    bool searched = false;
+    ChessMove best = {0, 0};
+    for (string const &operation : line.operations) {
+        istringstream words(operation);
+        string opcode, operand;
+        words >> opcode;
+        vector<string> operands;
+        while (words >> operand)
+            operands.push_back(operand);
+        string failure;
+
+        if ((opcode.size() > 1) && (opcode[0] == 'D') && (strspn(opcode.c_str() + 1, "0123456789") == opcode.size() - 1) && (operands.size() == 1)) {
+            uint64_t expected = strtoull(operands[0].c_str(), NULL, 10);
+            uint64_t count = perft(board, atoi(opcode.c_str() + 1), NULL);
+            if (count != expected)
+                failure = opcode + " " + operands[0] + " != " + to_string(count);
+        }
+        else if ((opcode == "status") && (operands.size() == 1)) {
+            GameStatus status = board.game_status();
+            if (operands[0] != STATUS_NAMES[status])
+                failure = "status " + operands[0] + " != " + STATUS_NAMES[status];
+        }
+        else if ((opcode == "dm") && (operands.size() == 1)) {
+            if (!tables.solver)
+                tables.solver.reset(new MateSolver(hash_megabytes));
+            tables.solver->clear();
+            int moves = atoi(operands[0].c_str());
+            MateResult result = tables.solver->solve(board, moves, node_limit);
+            if (result.status != mate_proven)
+                failure = "dm " + operands[0] + ((result.status == mate_disproven) ? " no mate" : " unsolved");
+            else if (moves > 1) {
+                /* The mate must also be the shortest one: none in a move less. */
+                tables.solver->clear();
+                MateResult shorter = tables.solver->solve(board, moves - 1, node_limit);
+                if (shorter.status != mate_disproven)
+                    failure = "dm " + operands[0] + ((shorter.status == mate_proven) ? " mate in fewer moves" : " shorter mate unsolved");
+            }
+        }
+        else if (((opcode == "bm") || (opcode == "am")) && !operands.empty()) {
+            if (search_depth <= 0) {
+                line.skipped++;
+                continue;
+            }
+            if (!searched) {
+                if (!tables.search)
+                    tables.search.reset(new ChessSearch(hash_megabytes));
+                tables.search->clear();
+                SearchLimits limits = {search_depth, 0, 0};
+                atomic<bool> stop(false);
+                SearchInfo info = tables.search->search(board, limits, stop, ChessSearch::InfoCallback());
+                if (info.pv_length > 0)
+                    best = info.pv[0];
+                searched = true;
+            }
+            bool listed = false;
+            for (string const &san : operands) {
+                ChessMove move = {0, 0};
+                if (!read_san(board, san, move))
+                    failure = opcode + " " + san + " is not a legal move";
+                listed = listed || (move == best);
+            }
+            if (failure.empty() && (listed != (opcode == "bm"))) {
+                char played[SAN_LENGTH] = "none";
+                if (best.from != best.to)
+                    write_san(board, best, played);
+                failure = operation + " but the search plays " + played;
+            }
+        }
+        else
+            continue;
+
+        line.checks++;
+        if (!failure.empty())
+            line.failures += (line.failures.empty() ? "" : "; ") + failure;
+    }
+    line.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    int threads = ChessThreadPool::hardware_threads(), search_depth = 0;
+    size_t hash_megabytes = 16;
+    uint64_t node_limit = 10000000;
+    for (int i=2; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+            search_depth = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-H") == 0) && (i + 1 < argc))
+            hash_megabytes = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            node_limit = strtoull(argv[++i], NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ifstream file(argv[1]);
+    if (!file) {
+        cerr << "Cannot open " << argv[1] << endl;
+        return 1;
+    }
+    vector<EpdLine> lines;
+    string text;
+    for (int number=1; getline(file, text); number++) {
+        if (text.empty() || (text[0] == '#') || (text.find_first_not_of(" \t\r") == string::npos))
+            continue;
+        EpdLine line = {number, "", {}, false, 0, 0, "", 0};
+        if (!split_line(text, line))
+            line.position.clear();
+        lines.push_back(line);
+    }
+
+    auto begin = chrono::steady_clock::now();
+    {
+        ChessThreadPool pool(threads);
+        vector<WorkerTables> tables(pool.size());
+        for (size_t i=0; i<lines.size(); i++) {
+            pool.submit([&, i](int worker) {
+                check_line(lines[i], tables[worker], search_depth, hash_megabytes, node_limit);
+            });
+        }
+        pool.wait();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    int passed = 0, failed = 0, invalid = 0, checks = 0, skipped = 0;
+    for (EpdLine const &line : lines) {
+        if (!line.valid) {
+            printf("line %d: invalid position\n", line.line);
+            invalid++;
+            continue;
+        }
+        checks += line.checks;
+        skipped += line.skipped;
+        if (line.failures.empty()) {
+            printf("line %d: pass", line.line);
+            passed++;
+        }
+        else {
+            printf("line %d: FAIL %s", line.line, line.failures.c_str());
+            failed++;
+        }
+        printf(" (%d check(s)", line.checks);
+        if (line.skipped > 0)
+            printf(", %d skipped", line.skipped);
+        printf(", %.1f ms)\n", line.seconds * 1000);
+    }
+    printf("\n%d passed, %d failed, %d invalid; %d checks (%d skipped), %.3f s with %d thread(s) (%.0f positions/s)\n", passed, failed, invalid, checks, skipped, seconds, (threads < 1) ? 1 : threads, (seconds > 0) ? (passed + failed) / seconds : 0.0);
+    return ((failed > 0) || (invalid > 0)) ? 1 : 0;
+}
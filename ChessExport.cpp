@@ -0,0 +1,188 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ChessExport.h"
+#include "ChessBoard.h"
+#include "ChessGameFile.h"
+#include "ChessThreadPool.h"
+
+/* Number of corpus lines replayed by one task. */
+static const size_t GAMES_PER_TASK = 4096;
+
+/* Bytes of the features of one position in the planes file. */
+static const size_t PLANE_BYTES = 12 * 64;
+
+/* Number of positions a worker fills in its buffers before writing them (3 MB of planes). */
+static const size_t EXPORT_CHUNK = 4096;
+
+/* Positions reached by one block of games, and the result of the game of each. */
+struct ExportRun {
+    vector<PackedPosition> positions;
+    vector<int8_t> results;
+};
+
+/* One .npy file being written: its descriptor and the size of its header, after which the rows start. */
+struct NpyFile {
+    int fd;
+    size_t header_size;
+};
+
+/* Return the header of a .npy file (format version 1.0) for an array of the given type and shape, padded with spaces so the data starts at a multiple of 64 bytes. */
+static string npy_header(const char *type, string const &shape) {
+    string dictionary = string("{'descr': '") + type + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    size_t length = 10 + dictionary.size() + 1;
+    dictionary.append((length + 63) / 64 * 64 - length, ' ');
+    dictionary += '\n';
+    string header("\x93NUMPY\x01\x00", 8);
+    header += char(dictionary.size() & 0xFF);
+    header += char(dictionary.size() >> 8);
+    return header + dictionary;
+}
+
+/* Function that creates a .npy file with its header, at its final size, so the rows can be written anywhere in it.
+@return false if the file cannot be created. */
+static bool create_npy(string const &path, string const &header, size_t const data_size, NpyFile &file) {
+    file.header_size = header.size();
+    file.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file.fd < 0)
+        return false;
+    return (pwrite(file.fd, header.data(), header.size(), 0) == ssize_t(header.size())) && (ftruncate(file.fd, header.size() + data_size) == 0);
+}
+
+/* Function that writes rows of a .npy file from a buffer.
+@param row: the first row written.
+@param row_size: the size of a row in bytes.
+@return false if the write failed. */
+static bool write_rows(NpyFile const &file, void const *rows, size_t const row, size_t const count, size_t const row_size) {
+    size_t size = count * row_size;
+    return pwrite(file.fd, rows, size, file.header_size + row * row_size) == ssize_t(size);
+}
+
+/* Set the plane bytes of the chess pieces of a position, in planes that are all zero. The piece codes are read in square order straight from the packed words. */
+static void write_planes(PackedPosition const &position, uint8_t *planes) {
+    uint64_t occupied = position.words[0];
+    for (int n=0; occupied!=0; n++, occupied&=occupied-1) {
+        int code = int(position.words[1 + n / 16] >> (4 * (n % 16))) & 15;
+        planes[((code & 7) + ((code & 8) ? 6 : 0)) * 64 + lowest_square(occupied)] = 1;
+    }
+}
+
+bool export_features(const char *corpus_path, const char *prefix, int const thread_count, ExportStats &stats) {
+    stats.games = 0;
+    stats.positions = 0;
+    stats.skipped = 0;
+    stats.replay_seconds = 0;
+    stats.write_seconds = 0;
+
+    CorpusFile corpus;
+    if (!corpus.open(corpus_path))
+        return false;
+    size_t task_count = corpus.block_count(GAMES_PER_TASK);
+
+    ChessThreadPool pool(thread_count);
+    vector<ExportRun> runs(task_count);
+
+    /* Replay the blocks of games in parallel, each worker on its own board. */
+    auto begin = chrono::steady_clock::now();
+    atomic<uint64_t> games(0), skipped(0);
+    {
+        vector<ChessBoard> boards(pool.size(), ChessBoard(PackedPosition::starting_position()));
+        for (size_t t=0; t<task_count; t++) {
+            pool.submit([&, t](int worker) {
+                ChessBoard &board = boards[worker];
+                vector<ChessMove> moves;
+                GameResult result;
+                string line;
+                uint64_t task_games = 0, task_skipped = 0;
+                size_t first, end;
+                corpus.block_lines(t, GAMES_PER_TASK, first, end);
+                for (size_t game=first; game<end; game++) {
+                    if (!corpus.game_line(game, line))
+                        continue;
+                    task_games++;
+                    if (!read_game(line, moves, result) || (result == unfinished)) {
+                        task_skipped++;
+                        continue;
+                    }
+                    /* Games with an illegal move are left out whole. */
+                    ExportRun &run = runs[t];
+                    size_t size = run.positions.size();
+                    if (replay_game(board, moves, run.positions) != moves.size()) {
+                        run.positions.resize(size);
+                        task_skipped++;
+                        continue;
+                    }
+                    run.results.resize(run.positions.size(), int8_t((result == white_wins) ? 1 : ((result == black_wins) ? -1 : 0)));
+                }
+                games += task_games;
+                skipped += task_skipped;
+            });
+        }
+        pool.wait();
+    }
+    corpus.close();
+    stats.games = games;
+    stats.skipped = skipped;
+    stats.replay_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    /* Every block writes from the position after those of the blocks before it. */
+    begin = chrono::steady_clock::now();
+    vector<size_t> offsets(task_count + 1, 0);
+    for (size_t t=0; t<task_count; t++)
+        offsets[t + 1] = offsets[t] + runs[t].positions.size();
+    size_t count = offsets[task_count];
+    stats.positions = count;
+
+    string base(prefix), rows = to_string(count);
+    NpyFile planes = {-1, 0}, side = {-1, 0}, castling = {-1, 0}, results = {-1, 0};
+    bool written = create_npy(base + "_planes.npy", npy_header("|u1", "(" + rows + ", 12, 8, 8)"), count * PLANE_BYTES, planes);
+    written = create_npy(base + "_side.npy", npy_header("|u1", "(" + rows + ",)"), count, side) && written;
+    written = create_npy(base + "_castling.npy", npy_header("|u1", "(" + rows + ", 4)"), count * 4, castling) && written;
+    written = create_npy(base + "_result.npy", npy_header("|i1", "(" + rows + ",)"), count, results) && written;
+
+    if (written) {
+        /* Every worker fills its own buffers, allocated once, a chunk of positions at a time. */
+        vector<vector<uint8_t>> plane_buffers(pool.size(), vector<uint8_t>(EXPORT_CHUNK * PLANE_BYTES));
+        vector<vector<uint8_t>> side_buffers(pool.size(), vector<uint8_t>(EXPORT_CHUNK));
+        vector<vector<uint8_t>> castling_buffers(pool.size(), vector<uint8_t>(EXPORT_CHUNK * 4));
+        atomic<bool> failed(false);
+        for (size_t t=0; t<task_count; t++) {
+            pool.submit([&, t](int worker) {
+                ExportRun const &run = runs[t];
+                uint8_t *plane_rows = plane_buffers[worker].data(), *side_rows = side_buffers[worker].data(), *castling_rows = castling_buffers[worker].data();
+                bool ok = write_rows(results, run.results.data(), offsets[t], run.results.size(), 1);
+                for (size_t first=0; ok && (first<run.positions.size()); first+=EXPORT_CHUNK) {
+                    size_t chunk = min(EXPORT_CHUNK, run.positions.size() - first);
+                    memset(plane_rows, 0, chunk * PLANE_BYTES);
+                    for (size_t i=0; i<chunk; i++) {
+                        PackedPosition const &position = run.positions[first + i];
+                        write_planes(position, plane_rows + i * PLANE_BYTES);
+                        side_rows[i] = position.white_to_move() ? 1 : 0;
+                        int rights = position.castling();
+                        castling_rows[4 * i] = (rights & PackedPosition::white_king_side) ? 1 : 0;
+                        castling_rows[4 * i + 1] = (rights & PackedPosition::white_queen_side) ? 1 : 0;
+                        castling_rows[4 * i + 2] = (rights & PackedPosition::black_king_side) ? 1 : 0;
+                        castling_rows[4 * i + 3] = (rights & PackedPosition::black_queen_side) ? 1 : 0;
+                    }
+                    size_t row = offsets[t] + first;
+                    ok = write_rows(planes, plane_rows, row, chunk, PLANE_BYTES) && write_rows(side, side_rows, row, chunk, 1) && write_rows(castling, castling_rows, row, chunk, 4);
+                }
+                if (!ok)
+                    failed = true;
+            });
+        }
+        pool.wait();
+        written = !failed;
+    }
+    for (NpyFile const *file : {&planes, &side, &castling, &results}) {
+        if ((file->fd >= 0) && (close(file->fd) != 0))
+            written = false;
+    }
+    stats.write_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return written;
+}
@@ -0,0 +1,32 @@
+#ifndef CHESSEXPORT_H
+#define CHESSEXPORT_H
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/* Counts reported by export_features(). */
+struct ExportStats {
+    uint64_t games;
+    uint64_t positions;
+    /* Games left out: unfinished ("*"), malformed, or with a move that is not legal under the board's rules. */
+    uint64_t skipped;
+    /* Time spent replaying the games, and writing the features of their positions. */
+    double replay_seconds;
+    double write_seconds;
+};
+
+/* Function that replays the games of a corpus file (see ChessGameFile.h) and writes every position they reach, the starting position included, as training features in NumPy .npy files (format version 1.0, readable with numpy.load() and memory mappable with mmap_mode):
+<prefix>_planes.npy   uint8 (N, 12, 8, 8): one plane per piece code, white king, queen, rook, bishop, knight, pawn then the same for black, indexed [plane][rank][file] with rank 0 being rank 1; 1 where the piece stands
+<prefix>_side.npy     uint8 (N,): 1 if white is to move
+<prefix>_castling.npy uint8 (N, 4): white king side, white queen side, black king side, black queen side rights
+<prefix>_result.npy   int8 (N,): result of the game for white, 1 won, 0 drawn, -1 lost
+Only finished games whose every move is legal are exported. Blocks of games are replayed in parallel into packed positions. The files are then created at their final size, and the blocks are expanded in parallel, each worker filling large buffers allocated once and writing them to the block's own range of rows, so every file is written in big sequential pieces.
+@param corpus_path: the corpus file.
+@param prefix: the path prefix of the .npy files.
+@param thread_count: the number of threads.
+@param stats: set to the numbers of games and positions.
+@return false if the corpus cannot be read or a file cannot be written. */
+bool export_features(const char *corpus_path, const char *prefix, int const thread_count, ExportStats &stats);
+
+#endif
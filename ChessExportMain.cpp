@@ -0,0 +1,44 @@
+#include "ChessExport.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/* Training feature exporter: writes the positions of a game corpus into NumPy .npy files.
+Usage: export_npy <corpus> <prefix> [-t threads]
+Every finished game of the corpus (see ChessGameFile.h) whose moves are all legal is replayed, and each position it reaches is written as 12 piece planes of 8x8 bytes, with the side to move, the castling rights and the result of the game, into <prefix>_planes.npy, <prefix>_side.npy, <prefix>_castling.npy and <prefix>_result.npy (see export_features()). The times of the replay and of the writing are reported with their positions per second. */
+
+static void usage() {
+    cerr << "Usage: export_npy <corpus> <prefix> [-t threads]" << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    int threads = ChessThreadPool::hardware_threads();
+    for (int i=3; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ExportStats stats;
+    if (!export_features(argv[1], argv[2], threads, stats)) {
+        cerr << "Cannot export " << argv[1] << " to " << argv[2] << "_*.npy" << endl;
+        return 1;
+    }
+    double seconds = stats.replay_seconds + stats.write_seconds;
+    printf("%llu games (%llu skipped), %llu positions exported with %d thread(s)\n", (unsigned long long)stats.games, (unsigned long long)stats.skipped, (unsigned long long)stats.positions, (threads < 1) ? 1 : threads);
+    printf("Replay %.3f s (%.0f positions/s), writing %.3f s (%.0f positions/s), total %.3f s (%.0f positions/s)\n", stats.replay_seconds, (stats.replay_seconds > 0) ? stats.positions / stats.replay_seconds : 0.0, stats.write_seconds, (stats.write_seconds > 0) ? stats.positions / stats.write_seconds : 0.0, seconds, (seconds > 0) ? stats.positions / seconds : 0.0);
+    return 0;
+}
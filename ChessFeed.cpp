@@ -0,0 +1,186 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ChessFeed.h"
+
+static const char FEED_MAGIC[9] = "CHESSFD1";
+
+/* Return the size of the shared memory of a feed. */
+static size_t feed_size(uint64_t const capacity, uint64_t const games) {
+    return sizeof(FeedRing) + capacity * sizeof(FeedSlot) + games * sizeof(FeedGame);
+}
+
+MoveFeed::MoveFeed() : memory(NULL), size(0), ring(NULL), slots(NULL), games(NULL), mask(0), next(0) {
+}
+
+MoveFeed::~MoveFeed() {
+    close();
+}
+
+void MoveFeed::close() {
+    if (memory == NULL)
+        return;
+    munmap(memory, size);
+    shm_unlink(name.c_str());
+    memory = NULL;
+    ring = NULL;
+    slots = NULL;
+    games = NULL;
+}
+
+bool MoveFeed::create(const char *feed_name, uint64_t const capacity, uint32_t const game_count) {
+    close();
+    if (game_count == 0)
+        return false;
+    uint64_t slot_count = 1;
+    while (slot_count < capacity)
+        slot_count *= 2;
+
+    /* A new object, so readers of an earlier feed of the same name keep their (now unlinked) mapping instead of seeing this one being set up. */
+    shm_unlink(feed_name);
+    int fd = shm_open(feed_name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return false;
+    size_t bytes = feed_size(slot_count, game_count);
+    void *mapped = MAP_FAILED;
+    if (ftruncate(fd, bytes) == 0)
+        mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(feed_name);
+        return false;
+    }
+
+    name = feed_name;
+    memory = mapped;
+    size = bytes;
+    ring = static_cast<FeedRing *>(memory);
+    slots = reinterpret_cast<FeedSlot *>(ring + 1);
+    games = reinterpret_cast<FeedGame *>(slots + slot_count);
+    mask = slot_count - 1;
+    next = 0;
+
+    /* The memory is zero filled, so every slot reads as empty; only the snapshots need the starting position. The magic is written last, so a reader never opens a feed still being set up. */
+    ring->capacity = slot_count;
+    ring->games = game_count;
+    PackedPosition start = PackedPosition::starting_position();
+    for (uint32_t g=0; g<game_count; g++) {
+        for (int i=0; i<4; i++)
+            games[g].words[i].store(start.words[i], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+    memcpy(ring->magic, FEED_MAGIC, sizeof(ring->magic));
+    return true;
+}
+
+
+
+FeedReader::FeedReader() : memory(NULL), size(0), ring(NULL), slots(NULL), games(NULL), mask(0), position(0) {
+}
+
+FeedReader::~FeedReader() {
+    close();
+}
+
+void FeedReader::close() {
+    if (memory == NULL)
+        return;
+    munmap(memory, size);
+    memory = NULL;
+    ring = NULL;
+    slots = NULL;
+    games = NULL;
+}
+
+bool FeedReader::opened() const {
+    return memory != NULL;
+}
+
+uint32_t FeedReader::game_count() const {
+    return (ring != NULL) ? uint32_t(ring->games) : 0;
+}
+
+bool FeedReader::open(const char *feed_name) {
+    close();
+    int fd = shm_open(feed_name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    void *mapped = MAP_FAILED;
+    if ((fstat(fd, &status) == 0) && (size_t(status.st_size) >= sizeof(FeedRing)))
+        mapped = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    FeedRing const *header = static_cast<FeedRing const *>(mapped);
+    bool valid = memcmp(header->magic, FEED_MAGIC, sizeof(header->magic)) == 0;
+    atomic_thread_fence(memory_order_acquire);
+    valid = valid && (header->capacity > 0) && ((header->capacity & (header->capacity - 1)) == 0) && (feed_size(header->capacity, header->games) <= size_t(status.st_size));
+    if (!valid) {
+        munmap(mapped, status.st_size);
+        return false;
+    }
+    memory = mapped;
+    size = status.st_size;
+    ring = header;
+    slots = reinterpret_cast<FeedSlot const *>(ring + 1);
+    games = reinterpret_cast<FeedGame const *>(slots + ring->capacity);
+    mask = ring->capacity - 1;
+    position = head();
+    return true;
+}
+
+uint64_t FeedReader::next_index() const {
+    return position;
+}
+
+uint64_t FeedReader::head() const {
+    return ring->head.load(memory_order_acquire);
+}
+
+FeedResult FeedReader::next(FeedDelta &delta) {
+    FeedSlot const &slot = slots[position & mask];
+    uint64_t expected = 2 * position + 2;
+    while (true) {
+        uint64_t before = slot.sequence.load(memory_order_acquire);
+        /* The producer is writing this delta right now. */
+        if (before == expected - 1)
+            continue;
+        /* An older delta (or none) is still in the slot: the producer has not got this far yet. */
+        if (before < expected)
+            return feed_empty;
+        if (before > expected)
+            return feed_overrun;
+        uint64_t bits = slot.delta.load(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != before)
+            return feed_overrun;
+        memcpy(&delta, &bits, sizeof(delta));
+        position++;
+        return feed_read;
+    }
+}
+
+uint64_t FeedReader::resync() {
+    position = head();
+    return position;
+}
+
+FeedSnapshot FeedReader::read_snapshot(uint32_t const game) const {
+    FeedGame const &entry = games[game];
+    FeedSnapshot snapshot;
+    while (true) {
+        uint64_t before = entry.sequence.load(memory_order_acquire);
+        if (before & 1)
+            continue;
+        for (int i=0; i<4; i++)
+            snapshot.position.words[i] = entry.words[i].load(memory_order_acquire);
+        snapshot.next_index = entry.words[4].load(memory_order_acquire);
+        snapshot.game_over = entry.words[5].load(memory_order_acquire) != 0;
+        if (entry.sequence.load(memory_order_relaxed) == before)
+            return snapshot;
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef CHESSFEED_H
+#define CHESSFEED_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* One record of a move feed: a move accepted in a game, as a compact binary delta instead of the text of the board's messages. */
+struct FeedDelta {
+    uint32_t game;
+    /* Squares of the move (rank * 8 + file), the king's squares for castling. */
+    uint8_t from;
+    uint8_t to;
+    /* Piece code of the chess piece taken (see PackedPosition::piece_codes), FEED_NO_CAPTURE if none. */
+    uint8_t captured;
+    /* The GameStatus of the team to move after the move (FEED_STATUS_MASK bits), with the FEED_CASTLING and FEED_POSITION flags. */
+    uint8_t flags;
+};
+
+static_assert(sizeof(FeedDelta) == 8, "FeedDelta must stay 8 bytes");
+
+const uint8_t FEED_NO_CAPTURE = 0xFF;
+const uint8_t FEED_STATUS_MASK = 0x03;
+const uint8_t FEED_CASTLING = 0x04;
+/* The position of the game was set without a move (new game, unpack(), play(), assignment): the delta holds no move, and the position is read from the game's snapshot. */
+const uint8_t FEED_POSITION = 0x08;
+
+/* Full position of one game in a feed. */
+struct FeedSnapshot {
+    PackedPosition position;
+    /* Index of the first delta of the feed not included in the position. */
+    uint64_t next_index;
+    bool game_over;
+};
+
+/* Results of FeedReader::next(). */
+enum FeedResult {feed_read, feed_empty, feed_overrun};
+
+/* Layout of a feed's shared memory: the header, then the ring of deltas (FeedRing::capacity slots), then the snapshot of every game. Each slot and snapshot is guarded by a sequence, as in SnapshotPublisher: odd while it is written, and the slot's sequence also tells which delta it holds (2 * index + 2), so a reader that fell a whole ring behind sees it has been overrun. */
+struct FeedRing {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t games;
+    uint64_t reserved[5];
+    /* Number of deltas published, on a cache line of its own. */
+    atomic<uint64_t> head;
+    uint64_t padding[7];
+};
+
+struct FeedSlot {
+    atomic<uint64_t> sequence;
+    atomic<uint64_t> delta;
+};
+
+struct FeedGame {
+    atomic<uint64_t> sequence;
+    /* The 4 words of the position, the next_index and the game_over flag of its FeedSnapshot. */
+    atomic<uint64_t> words[6];
+    uint64_t padding;
+};
+
+static_assert(sizeof(FeedRing) == 128 && sizeof(FeedSlot) == 16 && sizeof(FeedGame) == 64, "feed layout must not depend on the compiler");
+static_assert(atomic<uint64_t>::is_always_lock_free, "feed words are shared between processes and must be lock-free");
+
+/* Producer of a move feed: broadcasts the moves of live games through a single-producer, multi-consumer ring buffer in POSIX shared memory, read by any number of FeedReader processes at their own pace.
+Publishing a move writes its delta in the next slot of the ring and the game's snapshot in place, and never looks at the readers, so it costs the same few stores however many there are; a reader too slow to keep up is overrun and resyncs from the snapshots. Boards publish their accepted moves with ChessBoard::attach_feed(). publish() must only be called by one thread at a time (all the boards attached to a feed are used by the same thread). */
+class MoveFeed {
+    private:
+        string name;
+        void *memory;
+        size_t size;
+        FeedRing *ring;
+        FeedSlot *slots;
+        FeedGame *games;
+        uint64_t mask;
+        /* Index of the next delta to publish. */
+        uint64_t next;
+
+        /* Function that unmaps and removes the shared memory. */
+        void close();
+
+    public:
+        /* Default constructor that creates a closed feed (opened() returns false until create() succeeds). */
+        MoveFeed();
+
+        /* Destructor that removes the shared memory (readers that have it mapped keep their mapping). */
+        ~MoveFeed();
+
+        MoveFeed(MoveFeed const &) = delete;
+        MoveFeed &operator=(MoveFeed const &) = delete;
+
+        /* Method that creates the shared memory of the feed, replacing any left by an earlier producer of the same name. Every game starts with the starting position.
+        @param feed_name: the POSIX shared memory name (e.g. "/chess_feed").
+        @param capacity: the number of deltas the ring holds, rounded up to a power of two; a reader more than this many deltas behind is overrun.
+        @param game_count: the number of games, identified 0 to game_count - 1.
+        @return true if the shared memory could be created and mapped. */
+        bool create(const char *feed_name, uint64_t const capacity, uint32_t const game_count);
+
+        /* @return true if the feed is created. Inline, like publish(), so boards can check the feed they are attached to without linking ChessFeed.o. */
+        bool opened() const {
+            return memory != NULL;
+        }
+
+        /* @return the number of games of the feed. */
+        uint32_t game_count() const {
+            return (ring != NULL) ? uint32_t(ring->games) : 0;
+        }
+
+        /* Method that publishes a delta and the position of its game after it.
+        @param delta: the delta, whose game must be less than game_count().
+        @param position, game_over: the position of the game with the delta applied. */
+        void publish(FeedDelta const &delta, PackedPosition const &position, bool const game_over) {
+            uint64_t index = next++;
+            uint64_t bits;
+            static_assert(sizeof(bits) == sizeof(delta), "a delta is one word");
+            memcpy(&bits, &delta, sizeof(bits));
+            FeedSlot &slot = slots[index & mask];
+            slot.sequence.store(2 * index + 1, memory_order_relaxed);
+            slot.delta.store(bits, memory_order_release);
+            slot.sequence.store(2 * index + 2, memory_order_release);
+
+            FeedGame &game = games[delta.game];
+            uint64_t start = game.sequence.load(memory_order_relaxed);
+            game.sequence.store(start + 1, memory_order_relaxed);
+            for (int i=0; i<4; i++)
+                game.words[i].store(position.words[i], memory_order_release);
+            game.words[4].store(index + 1, memory_order_release);
+            game.words[5].store(game_over ? 1 : 0, memory_order_release);
+            game.sequence.store(start + 2, memory_order_release);
+            ring->head.store(index + 1, memory_order_release);
+        }
+};
+
+/* Consumer of a move feed, in any process: reads the deltas straight from the shared memory mapping (one word per delta, no copy of the ring and no system call) in order, from where it joined.
+To follow a game, read its snapshot, then apply the deltas of the game whose index (next_index() before next()) is at least the snapshot's next_index. When next() reports an overrun, call resync() and do the same again from the snapshots. */
+class FeedReader {
+    private:
+        void *memory;
+        size_t size;
+        FeedRing const *ring;
+        FeedSlot const *slots;
+        FeedGame const *games;
+        uint64_t mask;
+        /* Index of the next delta to read. */
+        uint64_t position;
+
+        void close();
+
+    public:
+        /* Default constructor that creates a closed reader (opened() returns false until open() succeeds). */
+        FeedReader();
+
+        ~FeedReader();
+
+        FeedReader(FeedReader const &) = delete;
+        FeedReader &operator=(FeedReader const &) = delete;
+
+        /* Method that maps the shared memory of a feed read-only, and joins it at its current head.
+        @param feed_name: the name given to MoveFeed::create().
+        @return true if the feed exists and is a move feed. */
+        bool open(const char *feed_name);
+
+        /* @return true if the reader is open. */
+        bool opened() const;
+
+        /* @return the number of games of the feed. */
+        uint32_t game_count() const;
+
+        /* @return the index of the next delta next() reads. */
+        uint64_t next_index() const;
+
+        /* @return the number of deltas published so far. */
+        uint64_t head() const;
+
+        /* Method that reads the next delta, without waiting.
+        @param delta: set to the delta if one is read.
+        @return feed_read if a delta was read, feed_empty if the reader is at the head of the feed, and feed_overrun if the next delta has been overwritten (see resync()). */
+        FeedResult next(FeedDelta &delta);
+
+        /* Method that moves the reader to the head of the feed, after an overrun; the games are then read again from their snapshots.
+        @return the new next_index(). */
+        uint64_t resync();
+
+        /* Method that returns the current snapshot of a game. May be called while the producer publishes: it retries instead of returning a snapshot being written.
+        @param game: a game less than game_count(). */
+        FeedSnapshot read_snapshot(uint32_t const game) const;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "ChessBoard.h"
+#include "ChessFeed.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <sched.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/wait.h>
+
+using namespace std;
+
+/* Move feed driver: broadcasts random games to subscriber processes through a shared-memory move feed, and checks what they receive.
+Usage: feed [-g games] [-m moves] [-r readers] [-c ring capacity] [-s seed] [-n shared memory name]
+The producer creates the feed and forks the readers, then first times publish() alone (FEED_POSITION deltas of the starting positions, which readers apply by reading the snapshot), so the cost per delta can be compared for different numbers of readers. It then plays random legal moves in every game in turn with submitMove(), restarting games that end, until the given number of moves. Every reader follows the feed at its own pace: it replays every move on its own board, checks the captured piece, castling flag and game status of each delta against it, resyncs from the snapshots when it is overrun, and finally compares its positions with the snapshots. The exit code is 1 if a reader found a difference. */
+
+static void usage() {
+    cerr << "Usage: feed [-g games] [-m moves] [-r readers] [-c ring capacity] [-s seed] [-n shared memory name]" << endl;
+}
+
+/* Set a reader's board of a game to the game's snapshot.
+@return the index of the first delta not in the snapshot. */
+static uint64_t load_snapshot(FeedReader const &reader, uint32_t const game, ChessBoard &board) {
+    FeedSnapshot snapshot = reader.read_snapshot(game);
+    board.unpack(snapshot.position);
+    return snapshot.next_index;
+}
+
+/* Main loop of a reader process, until it has read the number of deltas written to its pipe by the producer once it is done.
+@return the exit code of the process. */
+static int run_reader(int const number, const char *name, int const done_pipe) {
+    FeedReader reader;
+    if (!reader.open(name)) {
+        fprintf(stderr, "reader %d: cannot open the feed\n", number);
+        return 1;
+    }
+    uint32_t games = reader.game_count();
+    vector<unique_ptr<ChessBoard>> boards;
+    vector<uint64_t> skip(games);
+    for (uint32_t g=0; g<games; g++) {
+        boards.emplace_back(new ChessBoard(PackedPosition::starting_position()));
+        boards[g]->set_output(NULL, NULL);
+        skip[g] = load_snapshot(reader, g, *boards[g]);
+    }
+
+    uint64_t total = UINT64_MAX, read = 0, moves = 0, resyncs = 0, errors = 0;
+    while (true) {
+        uint64_t index = reader.next_index();
+        FeedDelta delta;
+        FeedResult result = reader.next(delta);
+        if (result == feed_empty) {
+            if (total == UINT64_MAX) {
+                uint64_t count;
+                if (::read(done_pipe, &count, sizeof(count)) == sizeof(count))
+                    total = count;
+            }
+            if (index >= total)
+                break;
+            sched_yield();
+            continue;
+        }
+        if (result == feed_overrun) {
+            resyncs++;
+            reader.resync();
+            for (uint32_t g=0; g<games; g++)
+                skip[g] = load_snapshot(reader, g, *boards[g]);
+            continue;
+        }
+
+        read++;
+        if ((delta.game >= games) || (index < skip[delta.game]))
+            continue;
+        ChessBoard &board = *boards[delta.game];
+        if (delta.flags & FEED_POSITION) {
+            skip[delta.game] = load_snapshot(reader, delta.game, board);
+            continue;
+        }
+        ChessMove move = {delta.from, delta.to};
+        int captured = board.piece_at(move.to);
+        int piece = board.piece_at(move.from);
+        bool castling = (piece >= 0) && ((piece & 7) == 0) && (abs(move.from % 8 - move.to % 8) == 2);
+        bool valid = (delta.captured == ((captured < 0) ? FEED_NO_CAPTURE : captured)) && (((delta.flags & FEED_CASTLING) != 0) == castling);
+        valid = valid && (board.submitMoves(&move, 1) == 1) && (board.game_status() == (delta.flags & FEED_STATUS_MASK));
+        if (!valid) {
+            errors++;
+            skip[delta.game] = load_snapshot(reader, delta.game, board);
+        }
+        moves++;
+    }
+
+    uint64_t different = 0;
+    for (uint32_t g=0; g<games; g++) {
+        if (!(boards[g]->pack() == reader.read_snapshot(g).position))
+            different++;
+    }
+    printf("reader %d: %llu deltas read, %llu moves replayed, %llu resyncs, %llu wrong deltas, %llu games different from their snapshot\n", number, (unsigned long long)read, (unsigned long long)moves, (unsigned long long)resyncs, (unsigned long long)errors, (unsigned long long)different);
+    return ((errors > 0) || (different > 0)) ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int games = 64, readers = 2;
+    long moves = 200000;
+    uint64_t capacity = 65536, seed = 1;
+    const char *name = "/chess_feed";
+    for (int i=1; i<argc; i++) {
+        if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+            games = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc))
+            moves = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+            readers = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+            capacity = strtoull(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            seed = strtoull(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            name = argv[++i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if ((games < 1) || (readers < 0)) {
+        usage();
+        return 1;
+    }
+
+    MoveFeed feed;
+    if (!feed.create(name, capacity, games)) {
+        cerr << "Cannot create the shared memory " << name << endl;
+        return 1;
+    }
+
+    /* Each reader gets a pipe the producer writes the final number of deltas to. */
+    vector<pid_t> children;
+    vector<int> done_pipes;
+    fflush(stdout);
+    for (int r=0; r<readers; r++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            cerr << "Cannot create a pipe" << endl;
+            return 1;
+        }
+        pid_t child = fork();
+        if (child == 0) {
+            ::close(fds[1]);
+            fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            int code = run_reader(r, name, fds[0]);
+            fflush(stdout);
+            _exit(code);
+        }
+        ::close(fds[0]);
+        children.push_back(child);
+        done_pipes.push_back(fds[1]);
+    }
+
+    /* Publishing alone: the same FEED_POSITION delta and position, so the time is that of publish() and nothing else. */
+    PackedPosition start = PackedPosition::starting_position();
+    const int PUBLISH_COUNT = 1000000;
+    auto begin = chrono::steady_clock::now();
+    for (int i=0; i<PUBLISH_COUNT; i++) {
+        FeedDelta delta = {uint32_t(i % games), 0, 0, FEED_NO_CAPTURE, FEED_POSITION};
+        feed.publish(delta, start, false);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("publish(): %d deltas in %.3f s (%.1f ns per delta) with %d reader(s)\n", PUBLISH_COUNT, seconds, seconds * 1e9 / PUBLISH_COUNT, readers);
+
+    /* Live games: one random legal move in every game in turn. */
+    vector<unique_ptr<ChessBoard>> boards;
+    for (int g=0; g<games; g++) {
+        boards.emplace_back(new ChessBoard(start));
+        boards[g]->set_output(NULL, NULL);
+        if (!boards[g]->attach_feed(&feed, g)) {
+            cerr << "Cannot attach game " << g << " to the feed" << endl;
+            return 1;
+        }
+    }
+    uint64_t state = seed;
+    long played = 0, finished = 0;
+    ChessMove legal[MAX_MOVES];
+    begin = chrono::steady_clock::now();
+    while (played < moves) {
+        for (int g=0; (g<games) && (played < moves); g++) {
+            ChessBoard &board = *boards[g];
+            int count = board.legal_moves(legal);
+            if (count == 0) {
+                board.resetBoard();
+                finished++;
+                continue;
+            }
+            ChessMove move = legal[splitmix64(state) % count];
+            char from[3], to[3];
+            square_name(move.from, from);
+            square_name(move.to, to);
+            board.submitMove(from, to);
+            played++;
+        }
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("submitMove() with the feed attached: %ld moves (%ld games finished) in %.3f s (%.0f moves/s)\n", played, finished, seconds, (seconds > 0) ? played / seconds : 0.0);
+
+    /* Tell the readers how many deltas there are, and wait for them. */
+    uint64_t total = PUBLISH_COUNT + games + played + finished;
+    bool failed = false;
+    for (int r=0; r<readers; r++) {
+        if (write(done_pipes[r], &total, sizeof(total)) != sizeof(total))
+            failed = true;
+        ::close(done_pipes[r]);
+    }
+    for (pid_t child : children) {
+        int status;
+        if ((waitpid(child, &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+            failed = true;
+    }
+    printf("%s\n", failed ? "FAILED: a reader received a different game" : "Every reader followed every game");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ChessGameFile.h"
+
+/* Result tokens, indexed by GameResult. */
+static const char *const RESULT_NAMES[4] = {"1-0", "0-1", "1/2-1/2", "*"};
+
+void append_game(string &out, ChessMove const *moves, size_t const count, GameResult const result) {
+    char token[6];
+    for (size_t i=0; i<count; i++) {
+        square_name(moves[i].from, token);
+        square_name(moves[i].to, token + 2);
+        token[4] = ' ';
+        out.append(token, 5);
+    }
+    out += RESULT_NAMES[result];
+    out += '\n';
+}
+
+bool read_move(const char *text, ChessMove &move) {
+    int from = square_from_name(text);
+    int to = square_from_name(text + 2);
+    if ((from < 0) || (to < 0))
+        return false;
+    move.from = from;
+    move.to = to;
+    return true;
+}
+
+bool read_game(string const &line, vector<ChessMove> &moves, GameResult &result) {
+    moves.clear();
+    if (line.empty() || (line[0] == '#'))
+        return false;
+
+    size_t i = 0;
+    while (i < line.size()) {
+        size_t end = line.find(' ', i);
+        if (end == string::npos)
+            end = line.size();
+        string token = line.substr(i, end - i);
+        if (!token.empty() && (token.back() == '\n'))
+            token.pop_back();
+        i = end + 1;
+
+        /* The result token ends the game. */
+        for (int r=0; r<4; r++) {
+            if (token == RESULT_NAMES[r]) {
+                result = GameResult(r);
+                return i >= line.size();
+            }
+        }
+        ChessMove move;
+        if ((token.size() != 4) || !read_move(token.c_str(), move))
+            return false;
+        moves.push_back(move);
+    }
+    return false;
+}
+
+size_t replay_game(ChessBoard &board, vector<ChessMove> const &moves, vector<PackedPosition> &positions) {
+    static const PackedPosition start = PackedPosition::starting_position();
+    board.unpack(start);
+    positions.push_back(start);
+    for (size_t i=0; i<moves.size(); i++) {
+        if (!board.is_legal(moves[i].from, moves[i].to))
+            return i;
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        ChessBoard::discard_undo(undo);
+        positions.push_back(board.pack());
+    }
+    return moves.size();
+}
+
+CorpusFile::CorpusFile() : text(NULL), text_size(0) {
+}
+
+CorpusFile::~CorpusFile() {
+    close();
+}
+
+bool CorpusFile::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void *address = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    ::close(fd);
+    if (address == MAP_FAILED)
+        return false;
+    text = static_cast<const char *>(address);
+    text_size = size;
+
+    for (size_t position=0; position<text_size; ) {
+        line_starts.push_back(position);
+        const char *end = static_cast<const char *>(memchr(text + position, '\n', text_size - position));
+        position = (end == NULL) ? text_size : size_t(end - text) + 1;
+    }
+    line_starts.push_back(text_size);
+    return true;
+}
+
+void CorpusFile::close() {
+    if (text != NULL)
+        munmap(const_cast<char *>(text), text_size);
+    text = NULL;
+    text_size = 0;
+    line_starts.clear();
+}
+
+size_t CorpusFile::line_count() const {
+    return line_starts.empty() ? 0 : line_starts.size() - 1;
+}
+
+size_t CorpusFile::block_count(size_t const lines_per_block) const {
+    return (line_count() + lines_per_block - 1) / lines_per_block;
+}
+
+void CorpusFile::block_lines(size_t const block, size_t const lines_per_block, size_t &first, size_t &end) const {
+    first = block * lines_per_block;
+    end = min(line_count(), first + lines_per_block);
+}
+
+bool CorpusFile::game_line(size_t const index, string &line) const {
+    line.assign(text + line_starts[index], line_starts[index + 1] - line_starts[index]);
+    if (!line.empty() && (line.back() == '\n'))
+        line.pop_back();
+    return !line.empty() && (line[0] != '#');
+}
@@ -0,0 +1,84 @@
+#ifndef CHESSGAMEFILE_H
+#define CHESSGAMEFILE_H
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Text format of game corpus files: one game per line, made of the moves from the starting position in the coordinate format accepted by ChessBoard::submitMove() (source square immediately followed by destination square, e.g. "E2E4"), separated by single spaces and followed by the result of the game:
+"1-0" white won, "0-1" black won, "1/2-1/2" stalemate, "*" not finished.
+For example: "F2F3 E7E5 G2G4 D8H4 0-1". Lines starting with '#' are comments. */
+
+enum GameResult {white_wins, black_wins, draw, unfinished};
+
+/* Function that appends one game, as a line ending with '\n', to a text buffer.
+@param out: the buffer to append to.
+@param moves: the moves of the game.
+@param count: the number of moves.
+@param result: the result of the game. */
+void append_game(string &out, ChessMove const *moves, size_t const count, GameResult const result);
+
+/* Function that reads a move in coordinate format ("E2E4", either case).
+@param text: at least 4 characters.
+@param move: set to the move read.
+@return true if both squares are valid. */
+bool read_move(const char *text, ChessMove &move);
+
+/* Function that reads one line of a corpus file. Moves are only checked to be well formed, not legal.
+@param line: the line, with or without the trailing '\n'.
+@param moves: set to the moves of the game.
+@param result: set to the result of the game.
+@return true if the line holds a game, false if it is a comment, is empty or is malformed. */
+bool read_game(string const &line, vector<ChessMove> &moves, GameResult &result);
+
+/* Function that replays a game from the starting position in a single pass, up to its first illegal move. Each move is checked on its own with ChessBoard::is_legal() instead of generating every legal move of the position, then made with ChessBoard::make(), which publishes no snapshot, so every position is packed once.
+@param board: the board to replay on, whatever its position.
+@param moves: the moves of the game, e.g. from read_game().
+@param positions: the starting position, then the position after every move played, are appended to it.
+@return the number of moves played: moves.size() if they are all legal. */
+size_t replay_game(ChessBoard &board, vector<ChessMove> const &moves, vector<PackedPosition> &positions);
+
+/* Corpus file mapped read-only into memory, with the start of every line found once, so the tools that replay a whole corpus can hand blocks of lines to different threads, which read them at the same time. */
+class CorpusFile {
+    private:
+        const char *text;
+        size_t text_size;
+        /* Start of every line, then the end of the text. */
+        vector<size_t> line_starts;
+
+    public:
+        CorpusFile();
+        ~CorpusFile();
+        CorpusFile(CorpusFile const &) = delete;
+        CorpusFile &operator=(CorpusFile const &) = delete;
+
+        /* Method that maps a corpus file (unmapping the one opened before, if any) and finds its lines.
+        @return false if the file cannot be read. */
+        bool open(const char *path);
+
+        /* Method that unmaps the file. */
+        void close();
+
+        /* @return the number of lines. */
+        size_t line_count() const;
+
+        /* Method that splits the lines into blocks of consecutive lines.
+        @param lines_per_block: the number of lines of every block but the last.
+        @return the number of blocks. */
+        size_t block_count(size_t const lines_per_block) const;
+
+        /* Method that gives the lines of a block.
+        @param block: the block, less than block_count(lines_per_block).
+        @param first, end: set to the first line of the block and the line after its last one. */
+        void block_lines(size_t const block, size_t const lines_per_block, size_t &first, size_t &end) const;
+
+        /* Method that copies a line without its trailing '\n'.
+        @param index: the line, less than line_count().
+        @param line: set to the text of the line.
+        @return false if the line is empty or a comment, so holds no game. */
+        bool game_line(size_t const index, string &line) const;
+};
+
+#endif
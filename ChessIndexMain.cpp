@@ -0,0 +1,119 @@
+#include "ChessBoard.h"
+#include "ChessGameFile.h"
+#include "ChessPositionIndex.h"
+#include "ChessSan.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/* Position index over a game corpus: which games reached a position.
+Usage: position_index build <corpus> <index> [-t threads]
+       position_index query <index> fen <FEN> [-n max listed]
+       position_index query <index> moves <E2E4 ...> [-n max listed]
+       position_index query <index> san <e4 e5 Nf3 ...> [-n max listed]
+"build" replays every game of a corpus file (see ChessGameFile.h) and writes the sorted index. "query" looks up the position given as FEN or as moves from the starting position (coordinate format or SAN), and lists the games (0-based line numbers of the corpus) and plies reaching it. */
+
+static void usage() {
+    cerr << "Usage: position_index build <corpus> <index> [-t threads]" << endl;
+    cerr << "       position_index query <index> fen <FEN> [-n max listed]" << endl;
+    cerr << "       position_index query <index> moves <E2E4 ...> [-n max listed]" << endl;
+    cerr << "       position_index query <index> san <e4 e5 Nf3 ...> [-n max listed]" << endl;
+}
+
+static int build(int argc, char **argv) {
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+    int threads = ChessThreadPool::hardware_threads();
+    for (int i=4; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    auto begin = chrono::steady_clock::now();
+    IndexBuildStats stats;
+    if (!PositionIndex::build(argv[2], argv[3], threads, stats)) {
+        cerr << "Cannot build the index of " << argv[2] << " into " << argv[3] << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("%llu games (%llu cut short at an illegal move), %llu positions indexed in %.3f s (%.0f games/s)\n", (unsigned long long)stats.games, (unsigned long long)stats.rejected, (unsigned long long)stats.positions, seconds, stats.games / seconds);
+    return 0;
+}
+
+static int query(int argc, char **argv) {
+    if (argc < 5) {
+        usage();
+        return 1;
+    }
+    PositionIndex index;
+    if (!index.load(argv[2])) {
+        cerr << "Cannot load the index " << argv[2] << endl;
+        return 1;
+    }
+
+    /* Set up the position from a FEN string or from moves played from the starting position. */
+    PackedPosition position = PackedPosition::starting_position();
+    size_t listed = 20;
+    string fen;
+    bool by_san = strcmp(argv[3], "san") == 0;
+    bool by_moves = by_san || (strcmp(argv[3], "moves") == 0);
+    if (!by_moves && (strcmp(argv[3], "fen") != 0)) {
+        usage();
+        return 1;
+    }
+    ChessBoard board(position);
+    for (int i=4; i<argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            listed = atol(argv[++i]);
+        else if (!by_moves)
+            fen += string(argv[i]) + " ";
+        else {
+            ChessMove move;
+            if (by_san ? !read_san(board, argv[i], move) : ((strlen(argv[i]) != 4) || !read_move(argv[i], move) || !(board.legal_destinations(move.from) & square_bit(move.to)))) {
+                cerr << "Illegal move " << argv[i] << endl;
+                return 1;
+            }
+            board.play(move);
+        }
+    }
+    if (by_moves)
+        position = board.pack();
+    else if (!PackedPosition::from_fen(fen, position)) {
+        cerr << "Invalid FEN " << fen << endl;
+        return 1;
+    }
+
+    auto begin = chrono::steady_clock::now();
+    IndexEntry const *first;
+    size_t found = index.lookup(position.key(), first);
+    double microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count();
+
+    printf("%s\n%zu occurrence(s) among %llu indexed positions, looked up in %.1f us\n", position.to_fen().c_str(), found, (unsigned long long)index.size(), microseconds);
+    for (size_t i=0; (i<found) && (i<listed); i++)
+        printf("game %u ply %u\n", first[i].game, first[i].ply);
+    if (found > listed)
+        printf("... %zu more\n", found - listed);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if ((argc >= 2) && (strcmp(argv[1], "build") == 0))
+        return build(argc, argv);
+    if ((argc >= 2) && (strcmp(argv[1], "query") == 0))
+        return query(argc, argv);
+    usage();
+    return 1;
+}
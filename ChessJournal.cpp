@@ -0,0 +1,307 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "ChessJournal.h"
+
+static const char CHECKPOINT_MAGIC[9] = "CHESSCK1";
+
+/* Return the check value of a record, mixing its fields with its number in the file. */
+static uint32_t record_check(JournalRecord const &record, uint64_t const index) {
+    return uint32_t(splitmix64_mix(record.game ^ (uint64_t(record.from) << 56) ^ (uint64_t(record.to) << 48) ^ (index * 0x9E3779B97F4A7C15ULL)));
+}
+
+static string journal_file(string const &base, uint64_t const generation) {
+    return base + ".journal." + to_string(generation);
+}
+
+static bool file_exists(string const &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+/* Sync the directory holding a file, so a file created or renamed in it survives a crash. */
+static bool sync_directory(string const &path) {
+    size_t slash = path.rfind('/');
+    string directory = (slash == string::npos) ? "." : path.substr(0, slash + 1);
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/* Read a checkpoint file. exists is set to false (and true returned) if there is none.
+@param entries: set to the games of the checkpoint, or NULL to read the header only. */
+static bool read_checkpoint(string const &path, uint64_t &generation, vector<CheckpointEntry> *entries, bool &exists) {
+    FILE *file = fopen(path.c_str(), "rb");
+    exists = file != NULL;
+    if (file == NULL)
+        return true;
+    char magic[8];
+    uint64_t count = 0;
+    bool read = (fread(magic, 1, 8, file) == 8) && (memcmp(magic, CHECKPOINT_MAGIC, 8) == 0);
+    read = read && (fread(&generation, sizeof(generation), 1, file) == 1) && (fread(&count, sizeof(count), 1, file) == 1);
+    if (read && (entries != NULL)) {
+        entries->resize(count);
+        read = fread(entries->data(), sizeof(CheckpointEntry), count, file) == count;
+    }
+    fclose(file);
+    return read;
+}
+
+/* Read every whole record of a journal file. Returns false if there is no such file. */
+static bool read_journal(string const &path, vector<JournalRecord> &records) {
+    records.clear();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        records.resize(info.st_size / sizeof(JournalRecord));
+        size_t size = records.size() * sizeof(JournalRecord), done = 0;
+        while (done < size) {
+            ssize_t n = read(fd, reinterpret_cast<char *>(records.data()) + done, size - done);
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        records.resize(done / sizeof(JournalRecord));
+    }
+    ::close(fd);
+    return true;
+}
+
+MoveJournal::MoveJournal() : journal_fd(-1), generation(0), first_generation(0), file_records(0), appended(0), durable(0), commits(0), failed(false), stopping(false) {
+}
+
+MoveJournal::~MoveJournal() {
+    close_journal();
+}
+
+bool MoveJournal::opened() const {
+    return journal_fd >= 0;
+}
+
+bool MoveJournal::open(const char *path) {
+    close_journal();
+    base_path = path;
+
+    /* Start after the checkpoint's generation and any journal file written since. */
+    uint64_t checkpoint_generation = 1;
+    bool exists;
+    if (!read_checkpoint(base_path + ".ckpt", checkpoint_generation, NULL, exists))
+        return false;
+    if (!exists)
+        checkpoint_generation = 1;
+    first_generation = checkpoint_generation;
+    uint64_t next = checkpoint_generation;
+    while (file_exists(journal_file(base_path, next)))
+        next++;
+
+    appended = 0;
+    durable = 0;
+    commits = 0;
+    failed = false;
+    stopping = false;
+    if (!start_journal(next))
+        return false;
+    committer = thread(&MoveJournal::run, this);
+    return true;
+}
+
+bool MoveJournal::start_journal(uint64_t const journal_generation) {
+    string path = journal_file(base_path, journal_generation);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0)
+        return false;
+    if (!sync_directory(path)) {
+        ::close(fd);
+        return false;
+    }
+    if (journal_fd >= 0)
+        ::close(journal_fd);
+    journal_fd = fd;
+    generation = journal_generation;
+    file_records = 0;
+    return true;
+}
+
+void MoveJournal::close_journal() {
+    if (committer.joinable()) {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        work.notify_one();
+        committer.join();
+    }
+    if (journal_fd >= 0)
+        ::close(journal_fd);
+    journal_fd = -1;
+}
+
+void MoveJournal::run() {
+    vector<JournalRecord> batch;
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        work.wait(guard, [this] { return !pending.empty() || stopping; });
+        if (pending.empty())
+            return;
+
+        /* Take every record appended so far, and let the next ones collect in the other buffer while this batch is written. */
+        batch.swap(pending);
+        uint64_t last = appended;
+        int fd = journal_fd;
+        guard.unlock();
+
+        const char *bytes = reinterpret_cast<const char *>(batch.data());
+        size_t size = batch.size() * sizeof(JournalRecord), done = 0;
+        bool written = true;
+        while (written && (done < size)) {
+            ssize_t n = write(fd, bytes + done, size - done);
+            written = n > 0;
+            if (written)
+                done += n;
+        }
+        written = written && (fdatasync(fd) == 0);
+        batch.clear();
+
+        guard.lock();
+        if (written)
+            durable = last;
+        else
+            failed = true;
+        commits++;
+        durable_changed.notify_all();
+    }
+}
+
+uint64_t MoveJournal::append(uint64_t const game, uint8_t const from, uint8_t const to) {
+    uint64_t number;
+    {
+        lock_guard<mutex> guard(lock);
+        JournalRecord record = {game, from, to, 0, 0};
+        record.check = record_check(record, file_records++);
+        pending.push_back(record);
+        number = ++appended;
+    }
+    work.notify_one();
+    return number;
+}
+
+uint64_t MoveJournal::record_move(uint64_t const game, ChessMove const &move) {
+    return append(game, move.from, move.to);
+}
+
+uint64_t MoveJournal::record_new_game(uint64_t const game) {
+    return append(game, JOURNAL_NEW_GAME, 0);
+}
+
+uint64_t MoveJournal::record_end_game(uint64_t const game) {
+    return append(game, JOURNAL_END_GAME, 0);
+}
+
+bool MoveJournal::wait_durable(uint64_t const record) {
+    unique_lock<mutex> guard(lock);
+    durable_changed.wait(guard, [&] { return (durable >= record) || failed; });
+    return !failed;
+}
+
+uint64_t MoveJournal::commit_count() {
+    lock_guard<mutex> guard(lock);
+    return commits;
+}
+
+bool MoveJournal::checkpoint(vector<CheckpointEntry> const &games) {
+    unique_lock<mutex> guard(lock);
+    /* Wait for the commit thread to write everything appended so far, so no batch is being written while the journal file changes. */
+    durable_changed.wait(guard, [this] { return (durable == appended) || failed; });
+    if (failed || (journal_fd < 0))
+        return false;
+
+    /* Records made from now on go to a new journal file, which recovery replays after the checkpoint (or after the current files if the checkpoint cannot be written). */
+    uint64_t old_generation = generation;
+    if (!start_journal(generation + 1))
+        return false;
+
+    string path = base_path + ".ckpt", temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    uint64_t count = games.size();
+    bool written = (fwrite(CHECKPOINT_MAGIC, 1, 8, file) == 8) && (fwrite(&generation, sizeof(generation), 1, file) == 1) && (fwrite(&count, sizeof(count), 1, file) == 1);
+    written = written && (fwrite(games.data(), sizeof(CheckpointEntry), count, file) == count);
+    written = written && (fflush(file) == 0) && (fsync(fileno(file)) == 0);
+    written = (fclose(file) == 0) && written;
+    /* The new checkpoint replaces the old one at once, so a crash leaves one or the other. */
+    written = written && (rename(temporary.c_str(), path.c_str()) == 0) && sync_directory(path);
+    if (!written) {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    for (uint64_t g=first_generation; g<=old_generation; g++)
+        remove(journal_file(base_path, g).c_str());
+    first_generation = generation;
+    return true;
+}
+
+bool MoveJournal::recover(const char *path, unordered_map<uint64_t, PackedPosition> &games, JournalRecovery &stats) {
+    games.clear();
+    stats = {0, 0, 0, 0, 0};
+    string base = path;
+    uint64_t generation = 1;
+    vector<CheckpointEntry> entries;
+    bool exists;
+    if (!read_checkpoint(base + ".ckpt", generation, &entries, exists))
+        return false;
+    if (!exists)
+        generation = 1;
+    for (CheckpointEntry const &entry : entries)
+        games[entry.game] = entry.position;
+    stats.checkpoint_games = entries.size();
+    vector<CheckpointEntry>().swap(entries);
+
+    /* Collect the moves made in each game since the checkpoint, file after file up to the first torn record of each. */
+    PackedPosition start = PackedPosition::starting_position();
+    unordered_map<uint64_t, vector<ChessMove>> tails;
+    vector<JournalRecord> records;
+    for (uint64_t g=generation; read_journal(journal_file(base, g), records); g++) {
+        stats.files++;
+        for (size_t i=0; i<records.size(); i++) {
+            JournalRecord const &record = records[i];
+            if (record.check != record_check(record, i))
+                break;
+            stats.records++;
+            if (record.from == JOURNAL_NEW_GAME) {
+                games[record.game] = start;
+                tails.erase(record.game);
+            }
+            else if (record.from == JOURNAL_END_GAME) {
+                games.erase(record.game);
+                tails.erase(record.game);
+            }
+            else {
+                games.emplace(record.game, start);
+                ChessMove move = {record.from, record.to};
+                tails[record.game].push_back(move);
+            }
+        }
+    }
+
+    /* Replay the moves of each game at once: legality is checked for each move, but the game status only worked out at the end. */
+    ChessBoard board(start);
+    for (auto const &tail : tails) {
+        PackedPosition &position = games[tail.first];
+        board.unpack(position);
+        if (board.submitMoves(tail.second.data(), tail.second.size()) < tail.second.size())
+            stats.rejected_games++;
+        stats.replayed_games++;
+        position = board.pack();
+    }
+    return true;
+}
@@ -0,0 +1,132 @@
+#ifndef CHESSJOURNAL_H
+#define CHESSJOURNAL_H
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* One record of a journal file: a move accepted in a game, or a game started from the starting position (from is JOURNAL_NEW_GAME) or finished and forgotten (from is JOURNAL_END_GAME). check is computed from the other fields and the record's number in its file, so a record torn by a crash (or left over from an older file) is detected. */
+struct JournalRecord {
+    uint64_t game;
+    uint8_t from;
+    uint8_t to;
+    uint16_t reserved;
+    uint32_t check;
+};
+
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord must stay 16 bytes");
+
+const uint8_t JOURNAL_NEW_GAME = 0xFF;
+const uint8_t JOURNAL_END_GAME = 0xFE;
+
+/* Position of one game in a checkpoint file. */
+struct CheckpointEntry {
+    uint64_t game;
+    PackedPosition position;
+};
+
+/* Counts reported by MoveJournal::recover(). */
+struct JournalRecovery {
+    /* Games read from the checkpoint, journal records replayed after it, and journal files read. */
+    uint64_t checkpoint_games;
+    uint64_t records;
+    uint64_t files;
+    /* Games with moves replayed, and games whose replay stopped at a move that is not legal under the board's rules. */
+    uint64_t replayed_games;
+    uint64_t rejected_games;
+};
+
+/* Crash-safe journal of the moves accepted in many games, with group commit and checkpoints.
+Files: <base>.ckpt holds the position of every game at the last checkpoint (the magic "CHESSCK1", the journal generation it was taken at, the number of games, then the CheckpointEntry values), and <base>.journal.<generation> the records appended after it, one file per generation.
+Records are appended to a buffer and written by a commit thread: while it writes and syncs one batch, the next batch collects every record appended meanwhile, so one fdatasync() covers many moves however many threads record them. A caller that must not acknowledge a move before it is on disk waits for its record with wait_durable(). A checkpoint starts a new journal file and atomically replaces the checkpoint file, after which the older journal files are removed, so recovery reads the checkpoint and replays only the records appended after it. */
+class MoveJournal {
+    private:
+        string base_path;
+        int journal_fd;
+        uint64_t generation;
+        /* Oldest journal generation still on disk. */
+        uint64_t first_generation;
+        /* Number of records in the current journal file. */
+        uint64_t file_records;
+
+        /* Records appended but not handed to the commit thread yet, the number of records appended and the number known to be on disk. */
+        vector<JournalRecord> pending;
+        uint64_t appended;
+        uint64_t durable;
+        uint64_t commits;
+        bool failed;
+        bool stopping;
+
+        mutex lock;
+        condition_variable work;
+        condition_variable durable_changed;
+        thread committer;
+
+        /* Main loop of the commit thread. */
+        void run();
+
+        /* Function that appends a record to the buffer and wakes up the commit thread.
+        @return the number of the record (see wait_durable()). */
+        uint64_t append(uint64_t const game, uint8_t const from, uint8_t const to);
+
+        /* Function that creates the journal file of a generation and makes it the current one. */
+        bool start_journal(uint64_t const journal_generation);
+
+        /* Function that stops the commit thread after it has written every record, and closes the journal file. */
+        void close_journal();
+
+    public:
+        /* Default constructor that creates a closed journal (opened() returns false until open() succeeds). */
+        MoveJournal();
+
+        /* Destructor that commits the records appended so far and closes the journal. */
+        ~MoveJournal();
+
+        MoveJournal(MoveJournal const &) = delete;
+        MoveJournal &operator=(MoveJournal const &) = delete;
+
+        /* Method that opens the journal for appending. A new journal file is started after the files already there, so anything torn at the end of an older file by a crash is left behind. Call recover() first to get the games back.
+        @param path: the base path of the journal files.
+        @return true if the checkpoint (if any) could be read and the new journal file created. */
+        bool open(const char *path);
+
+        /* @return true if the journal is open. */
+        bool opened() const;
+
+        /* Methods that record a move accepted in a game, a game started from the starting position, and a game finished (left out of recovery from then on). May be called from any number of threads.
+        @param game: the identifier of the game.
+        @param move: the move.
+        @return the number of the record, to pass to wait_durable(). */
+        uint64_t record_move(uint64_t const game, ChessMove const &move);
+        uint64_t record_new_game(uint64_t const game);
+        uint64_t record_end_game(uint64_t const game);
+
+        /* Method that blocks until a record (and every record before it) is on disk.
+        @param record: a number returned by one of the record methods.
+        @return false if writing the journal failed. */
+        bool wait_durable(uint64_t const record);
+
+        /* Method that writes a checkpoint. The positions must include every record made so far (e.g. taken while no game is being played), as the records made before the checkpoint are removed.
+        @param games: the position of every game in progress.
+        @return true if the checkpoint was written; false leaves the previous checkpoint and journal files in place. */
+        bool checkpoint(vector<CheckpointEntry> const &games);
+
+        /* @return the number of fdatasync() calls made for records so far (each covers a batch of records). */
+        uint64_t commit_count();
+
+        /* Function that recovers the position of every game: the checkpoint is read, then the records of the journal files after it are replayed, up to the first torn record of each file. The moves of each game are replayed together with ChessBoard::submitMoves(), so their legality is checked and the game status worked out only once per game.
+        @param path: the base path of the journal files.
+        @param games: set to the position of every game, by game identifier.
+        @param stats: set to the counts of what was read and replayed.
+        @return false if the checkpoint file exists but cannot be read. */
+        static bool recover(const char *path, unordered_map<uint64_t, PackedPosition> &games, JournalRecovery &stats);
+};
+
+#endif
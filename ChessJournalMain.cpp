@@ -0,0 +1,161 @@
+#include "ChessBoard.h"
+#include "ChessJournal.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/* Move journal driver: simulates a game server writing a journal, and recovers the games from it.
+Usage: journal run <base path> [-g games] [-p plies] [-t threads] [-c checkpoint every N plies] [-b games per batch]
+       journal recover <base path>
+"run" starts the games, then plays one random legal move in every game per round, spread over a thread pool in batches of games. Every move is recorded in the journal, and a batch only finishes (i.e. its moves are acknowledged) once its last record is on disk, so the throughput includes waiting for group commits. A checkpoint is written every N rounds. The run stops without a final checkpoint, as after a crash, and prints a digest of every game's position. "recover" reads the checkpoint and the journal tail back, and prints the same digest. */
+
+static void usage() {
+    cerr << "Usage: journal run <base path> [-g games] [-p plies] [-t threads] [-c checkpoint every N plies] [-b games per batch]" << endl;
+    cerr << "       journal recover <base path>" << endl;
+}
+
+/* Digest of the positions of all games, independent of their order. */
+static uint64_t game_digest(uint64_t const game, PackedPosition const &position) {
+    return position.key() ^ ((game + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+/* splitmix64 of a game and ply, so every game plays the same moves whatever the number of threads. */
+static uint64_t move_random(uint64_t const game, int const ply) {
+    return splitmix64_mix(game * 0x9E3779B97F4A7C15ULL + uint64_t(ply) * 0xD1B54A32D192ED03ULL);
+}
+
+static int run(int argc, char **argv) {
+    long games = 100000, batch = 256;
+    int plies = 40, threads = ChessThreadPool::hardware_threads(), checkpoint_interval = 16;
+    for (int i=3; i<argc; i++) {
+        if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+            games = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+            plies = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+            checkpoint_interval = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+            batch = atol(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if ((games < 1) || (batch < 1)) {
+        usage();
+        return 1;
+    }
+
+    MoveJournal journal;
+    if (!journal.open(argv[2])) {
+        cerr << "Cannot open the journal " << argv[2] << endl;
+        return 1;
+    }
+    vector<PackedPosition> positions(games, PackedPosition::starting_position());
+    uint64_t last = 0;
+    for (long g=0; g<games; g++)
+        last = journal.record_new_game(g);
+    journal.wait_durable(last);
+
+    auto begin = chrono::steady_clock::now();
+    double checkpoint_seconds = 0;
+    int checkpoints = 0;
+    long moves = 0;
+    bool failed = false;
+    {
+        ChessThreadPool pool(threads);
+        vector<unique_ptr<ChessBoard>> boards(pool.size());
+        vector<long> batch_moves((games + batch - 1) / batch);
+        for (int ply=0; ply<plies; ply++) {
+            for (long first=0; first<games; first+=batch) {
+                pool.submit([&, first, ply](int worker) {
+                    if (!boards[worker])
+                        boards[worker].reset(new ChessBoard(PackedPosition::starting_position()));
+                    ChessBoard &board = *boards[worker];
+                    ChessMove legal[MAX_MOVES];
+                    uint64_t record = 0;
+                    long played = 0;
+                    for (long g=first; (g<first+batch) && (g<games); g++) {
+                        board.unpack(positions[g]);
+                        int count = board.legal_moves(legal);
+                        if (count == 0)
+                            continue;
+                        ChessMove move = legal[move_random(g, ply) % count];
+                        board.play(move);
+                        positions[g] = board.pack();
+                        record = journal.record_move(g, move);
+                        played++;
+                    }
+                    /* Acknowledge the moves of the batch once they are on disk. */
+                    if (!journal.wait_durable(record))
+                        played = -1;
+                    batch_moves[first / batch] = played;
+                });
+            }
+            pool.wait();
+            for (long played : batch_moves) {
+                failed = failed || (played < 0);
+                moves += (played > 0) ? played : 0;
+            }
+
+            if ((checkpoint_interval > 0) && ((ply + 1) % checkpoint_interval == 0) && (ply + 1 < plies)) {
+                auto checkpoint_begin = chrono::steady_clock::now();
+                vector<CheckpointEntry> entries(games);
+                for (long g=0; g<games; g++)
+                    entries[g] = {uint64_t(g), positions[g]};
+                failed = failed || !journal.checkpoint(entries);
+                checkpoint_seconds += chrono::duration<double>(chrono::steady_clock::now() - checkpoint_begin).count();
+                checkpoints++;
+            }
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (failed) {
+        cerr << "Writing the journal failed" << endl;
+        return 1;
+    }
+
+    uint64_t commits = journal.commit_count(), digest = 0;
+    for (long g=0; g<games; g++)
+        digest ^= game_digest(g, positions[g]);
+    printf("%ld games, %ld moves in %.3f s with %d thread(s) (%.0f moves/s), %llu commits (%.1f records per fdatasync), %d checkpoint(s) in %.3f s\n", games, moves, seconds, (threads < 1) ? 1 : threads, moves / seconds, (unsigned long long)commits, commits ? double(moves + games) / commits : 0.0, checkpoints, checkpoint_seconds);
+    printf("digest %016llx\n", (unsigned long long)digest);
+    return 0;
+}
+
+static int recover(char **argv) {
+    auto begin = chrono::steady_clock::now();
+    unordered_map<uint64_t, PackedPosition> games;
+    JournalRecovery stats;
+    if (!MoveJournal::recover(argv[2], games, stats)) {
+        cerr << "Cannot read the checkpoint of " << argv[2] << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    uint64_t digest = 0;
+    for (auto const &game : games)
+        digest ^= game_digest(game.first, game.second);
+    printf("%zu games recovered in %.3f s: %llu from the checkpoint, %llu journal records in %llu file(s) replayed into %llu games (%llu stopped at an illegal move)\n", games.size(), seconds, (unsigned long long)stats.checkpoint_games, (unsigned long long)stats.records, (unsigned long long)stats.files, (unsigned long long)stats.replayed_games, (unsigned long long)stats.rejected_games);
+    printf("digest %016llx\n", (unsigned long long)digest);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if ((argc >= 3) && (strcmp(argv[1], "run") == 0))
+        return run(argc, argv);
+    if ((argc == 3) && (strcmp(argv[1], "recover") == 0))
+        return recover(argv);
+    usage();
+    return 1;
+}
@@ -0,0 +1,122 @@
+#include "ChessBoard.h"
+#include "ChessMateSolver.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/* Batch mate solver for puzzle files.
+Usage: mate_solver <puzzle file> [-t threads] [-H hash megabytes per thread] [-n node limit] [-m default moves]
+Each line of the puzzle file holds a position in FEN, optionally followed by the EPD operation "dm <N>;" (direct mate in N moves, otherwise the -m value is used). Empty lines and lines starting with '#' are skipped. Puzzles are spread over a thread pool, every worker with its own bounded solver table, and the results are printed in file order followed by a summary. */
+
+struct Puzzle {
+    int line;
+    string fen;
+    int moves;
+    MateResult result;
+    bool valid;
+};
+
+static void usage() {
+    cerr << "Usage: mate_solver <puzzle file> [-t threads] [-H hash megabytes per thread] [-n node limit] [-m default moves]" << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    int threads = ChessThreadPool::hardware_threads();
+    size_t hash_megabytes = 64;
+    uint64_t node_limit = 10000000;
+    int default_moves = 3;
+    for (int i=2; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-H") == 0) && (i + 1 < argc))
+            hash_megabytes = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            node_limit = strtoull(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc))
+            default_moves = atoi(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ifstream file(argv[1]);
+    if (!file) {
+        cerr << "Cannot open " << argv[1] << endl;
+        return 1;
+    }
+    vector<Puzzle> puzzles;
+    string line;
+    for (int number=1; getline(file, line); number++) {
+        if (line.empty() || (line[0] == '#'))
+            continue;
+        Puzzle puzzle = {number, line, default_moves, {mate_unknown, {0, 0}, 0, 0}, false};
+        size_t operation = line.find("dm ");
+        if (operation != string::npos) {
+            puzzle.moves = atoi(line.c_str() + operation + 3);
+            puzzle.fen = line.substr(0, operation);
+        }
+        puzzles.push_back(puzzle);
+    }
+
+    /* One solver per worker, each with its own table so the workers never contend. */
+    auto begin = chrono::steady_clock::now();
+    {
+        ChessThreadPool pool(threads);
+        vector<unique_ptr<MateSolver>> solvers(pool.size());
+        for (size_t i=0; i<puzzles.size(); i++) {
+            pool.submit([&, i](int worker) {
+                Puzzle &puzzle = puzzles[i];
+                PackedPosition position;
+                if (!PackedPosition::from_fen(puzzle.fen, position))
+                    return;
+                puzzle.valid = true;
+                if (!solvers[worker])
+                    solvers[worker].reset(new MateSolver(hash_megabytes));
+                solvers[worker]->clear();
+                ChessBoard board(position);
+                puzzle.result = solvers[worker]->solve(board, puzzle.moves, node_limit);
+            });
+        }
+        pool.wait();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    int counts[3] = {0, 0, 0}, invalid = 0;
+    double solve_seconds = 0;
+    static const char *const STATUS_NAMES[3] = {"solved", "no mate", "unsolved"};
+    for (auto &puzzle : puzzles) {
+        if (!puzzle.valid) {
+            printf("line %d: invalid FEN\n", puzzle.line);
+            invalid++;
+            continue;
+        }
+        MateResult const &result = puzzle.result;
+        counts[result.status]++;
+        solve_seconds += result.seconds;
+        printf("line %d: mate in %d %s", puzzle.line, puzzle.moves, STATUS_NAMES[result.status]);
+        if (result.status == mate_proven) {
+            char from[3], to[3];
+            square_name(result.move.from, from);
+            square_name(result.move.to, to);
+            printf(" key move %s%s", from, to);
+        }
+        printf(" (%llu nodes, %.1f ms)\n", (unsigned long long)result.nodes, result.seconds * 1000);
+    }
+    int puzzle_count = counts[0] + counts[1] + counts[2];
+    printf("\n%d solved, %d no mate, %d unsolved, %d invalid; %.1f ms per puzzle, %.3f s in total with %d thread(s)\n", counts[mate_proven], counts[mate_disproven], counts[mate_unknown], invalid, puzzle_count ? solve_seconds * 1000 / puzzle_count : 0.0, seconds, (threads < 1) ? 1 : threads);
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include "ChessMateSolver.h"
+
+/* Proof or disproof number of a solved node. */
+static const uint32_t PROOF_INFINITY = 100000000;
+
+MateSolver::MateSolver(size_t const megabytes) : nodes(0), node_limit(0) {
+    size_t count = 2;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+        count *= 2;
+    table.resize(count);
+    table_mask = count - 1;
+    clear();
+}
+
+void MateSolver::clear() {
+    Entry empty = {0, 1, 1, 0};
+    fill(table.begin(), table.end(), empty);
+}
+
+uint64_t MateSolver::node_key(ChessBoard const &board, int const plies_left) {
+    return board.position_key() ^ ((plies_left + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+void MateSolver::lookup(uint64_t const key, uint32_t &phi, uint32_t &delta) const {
+    size_t index = key & table_mask & ~size_t(1);
+    for (size_t i=index; i<index+2; i++) {
+        if ((table[i].key == key) && (table[i].work > 0)) {
+            phi = table[i].phi;
+            delta = table[i].delta;
+            return;
+        }
+    }
+    phi = 1;
+    delta = 1;
+}
+
+void MateSolver::store(uint64_t const key, uint32_t const phi, uint32_t const delta, uint64_t const work) {
+    size_t index = key & table_mask & ~size_t(1);
+    /* Update the node's own slot if it has one, otherwise replace the slot holding less work. */
+    Entry *slot = &table[index];
+    if (table[index + 1].key == key)
+        slot = &table[index + 1];
+    else if ((table[index].key != key) && (table[index + 1].work < table[index].work))
+        slot = &table[index + 1];
+    slot->key = key;
+    slot->phi = phi;
+    slot->delta = delta;
+    slot->work = max<uint64_t>(work, 1);
+}
+
+void MateSolver::search(ChessBoard &board, int const plies_left, uint32_t const th_phi, uint32_t const th_delta) {
+    nodes++;
+    uint64_t start_nodes = nodes;
+    uint64_t key = node_key(board, plies_left);
+    bool attacker = (plies_left % 2) == 1;
+
+    /* Terminal nodes: the team to move is mated (a loss for it whichever side it is), stalemated (a draw, so no mate), or the attacker has run out of moves. */
+    ChessMove moves[MAX_MOVES];
+    int count = board.legal_moves(moves);
+    if (count == 0) {
+        if (board.in_check() || attacker)
+            store(key, PROOF_INFINITY, 0, 1);
+        else
+            store(key, 0, PROOF_INFINITY, 1);
+        return;
+    }
+    if (plies_left == 0) {
+        store(key, 0, PROOF_INFINITY, 1);
+        return;
+    }
+
+    uint64_t child_keys[MAX_MOVES];
+    for (int i=0; i<count; i++) {
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        child_keys[i] = node_key(board, plies_left - 1);
+        board.unmake(moves[i], undo);
+    }
+
+    while (true) {
+        /* phi is the smallest delta of the children, delta the sum of their phi. The best child has the smallest delta. */
+        uint32_t phi = PROOF_INFINITY, second_delta = PROOF_INFINITY, best_phi = 0;
+        uint64_t delta = 0;
+        int best = 0;
+        for (int i=0; i<count; i++) {
+            uint32_t child_phi, child_delta;
+            lookup(child_keys[i], child_phi, child_delta);
+            if (child_delta < phi) {
+                second_delta = phi;
+                phi = child_delta;
+                best_phi = child_phi;
+                best = i;
+            }
+            else if (child_delta < second_delta)
+                second_delta = child_delta;
+            delta = min<uint64_t>(delta + child_phi, PROOF_INFINITY);
+        }
+
+        if ((phi >= th_phi) || (delta >= th_delta) || (nodes >= node_limit)) {
+            store(key, phi, uint32_t(delta), nodes - start_nodes + 1);
+            return;
+        }
+
+        /* Search the best child until it stops being the best or the thresholds of this node are reached. */
+        uint64_t child_th_phi = min<uint64_t>(th_delta + uint64_t(best_phi) - delta, PROOF_INFINITY);
+        uint32_t child_th_delta = min<uint64_t>(th_phi, uint64_t(second_delta) + 1);
+        ChessMoveUndo undo;
+        board.make(moves[best], undo);
+        search(board, plies_left - 1, uint32_t(child_th_phi), child_th_delta);
+        board.unmake(moves[best], undo);
+    }
+}
+
+MateResult MateSolver::solve(ChessBoard &board, int const moves, uint64_t const max_nodes) {
+    auto begin = chrono::steady_clock::now();
+    nodes = 0;
+    node_limit = max_nodes;
+    int plies = 2 * moves - 1;
+
+    MateResult result = {mate_unknown, {0, 0}, 0, 0};
+    if (moves >= 1) {
+        search(board, plies, PROOF_INFINITY, PROOF_INFINITY);
+        uint32_t phi, delta;
+        lookup(node_key(board, plies), phi, delta);
+        if (phi == 0)
+            result.status = mate_proven;
+        else if (delta == 0)
+            result.status = mate_disproven;
+    }
+    else
+        result.status = mate_disproven;
+
+    /* The mating move leads to a proven defender node, i.e. a child whose delta is 0. */
+    if (result.status == mate_proven) {
+        ChessMove legal[MAX_MOVES];
+        int count = board.legal_moves(legal);
+        for (int i=0; i<count; i++) {
+            ChessMoveUndo undo;
+            board.make(legal[i], undo);
+            uint32_t child_phi, child_delta;
+            lookup(node_key(board, plies - 1), child_phi, child_delta);
+            board.unmake(legal[i], undo);
+            if (child_delta == 0) {
+                result.move = legal[i];
+                break;
+            }
+        }
+    }
+    result.nodes = nodes;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return result;
+}
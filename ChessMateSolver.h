@@ -0,0 +1,66 @@
+#ifndef CHESSMATESOLVER_H
+#define CHESSMATESOLVER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Outcome of a mate search. */
+enum MateStatus {mate_proven, mate_disproven, mate_unknown};
+
+struct MateResult {
+    MateStatus status;
+    /* First move of a forced mate (only when proven). */
+    ChessMove move;
+    uint64_t nodes;
+    double seconds;
+};
+
+/* Depth-first proof-number search (df-pn) for forced mates. The team to move is the attacker: a position is proven when every defence runs into a checkmate within the given number of moves, and disproven when some defence avoids it (or the attacker is the one mated or stalemated). Checkmate and stalemate are the board's own (no legal move, in check or not).
+Proof and disproof numbers are kept in a fixed-size table, so memory stays bounded however long the search runs; entries that cost the least work to compute are replaced first. The number of plies left is part of each table key, so positions reached with different depths left are not confused. */
+class MateSolver {
+    private:
+        struct Entry {
+            uint64_t key;
+            uint32_t phi;
+            uint32_t delta;
+            uint64_t work;
+        };
+
+        vector<Entry> table;
+        size_t table_mask;
+
+        uint64_t nodes;
+        uint64_t node_limit;
+
+        /* Function that returns the table key of a position with a number of plies left. */
+        static uint64_t node_key(ChessBoard const &board, int const plies_left);
+
+        /* Function that reads the proof numbers of a node (1 and 1 if not in the table). */
+        void lookup(uint64_t const key, uint32_t &phi, uint32_t &delta) const;
+
+        /* Function that stores the proof numbers of a node in one of the two slots of its bucket. */
+        void store(uint64_t const key, uint32_t const phi, uint32_t const delta, uint64_t const work);
+
+        /* Multiple iterative deepening step of df-pn: expands the node until its phi reaches th_phi or its delta reaches th_delta (phi and delta are the proof and disproof numbers seen from the team to move). */
+        void search(ChessBoard &board, int const plies_left, uint32_t const th_phi, uint32_t const th_delta);
+
+    public:
+        /* Constructor that allocates the table.
+        @param megabytes: size of the table. */
+        explicit MateSolver(size_t const megabytes);
+
+        /* Method that empties the table. */
+        void clear();
+
+        /* Method that searches for a forced mate by the team to move.
+        @param board: the position (back to its original state on return).
+        @param moves: the number of attacker moves allowed (mate in moves).
+        @param max_nodes: the number of nodes after which the search gives up (mate_unknown).
+        @return the outcome, first mating move, node count and time. */
+        MateResult solve(ChessBoard &board, int const moves, uint64_t const max_nodes);
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "ChessNetwork.h"
+
+/* Layout of the weights file: a 64 byte header followed by the weights and biases of each layer, every section starting on a 64 byte boundary. */
+
+static const char NETWORK_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'N', 'N', '1'};
+
+static size_t align64(size_t const size) {
+    return (size + 63) & ~size_t(63);
+}
+
+static const size_t FEATURE_WEIGHTS_OFFSET = 64;
+static const size_t FEATURE_BIAS_OFFSET = FEATURE_WEIGHTS_OFFSET + align64(sizeof(int16_t) * NETWORK_FEATURES * NETWORK_HIDDEN);
+static const size_t L1_WEIGHTS_OFFSET = FEATURE_BIAS_OFFSET + align64(sizeof(int16_t) * NETWORK_HIDDEN);
+static const size_t L1_BIAS_OFFSET = L1_WEIGHTS_OFFSET + align64(sizeof(int8_t) * NETWORK_L1 * 2 * NETWORK_HIDDEN);
+static const size_t L2_WEIGHTS_OFFSET = L1_BIAS_OFFSET + align64(sizeof(int32_t) * NETWORK_L1);
+static const size_t L2_BIAS_OFFSET = L2_WEIGHTS_OFFSET + align64(sizeof(int8_t) * NETWORK_L2 * NETWORK_L1);
+static const size_t OUTPUT_WEIGHTS_OFFSET = L2_BIAS_OFFSET + align64(sizeof(int32_t) * NETWORK_L2);
+static const size_t OUTPUT_BIAS_OFFSET = OUTPUT_WEIGHTS_OFFSET + align64(sizeof(int8_t) * NETWORK_L2);
+static const size_t NETWORK_FILE_SIZE = OUTPUT_BIAS_OFFSET + align64(sizeof(int32_t));
+
+/* Right shift applied to the hidden layer sums, and divisor from the output to centipawns. */
+static const int ACTIVATION_SHIFT = 6;
+static const int OUTPUT_SCALE = 16;
+
+
+
+/* Scalar kernels */
+
+static void scalar_add_row(int16_t *accumulator, const int16_t *row) {
+    for (int i=0; i<NETWORK_HIDDEN; i++)
+        accumulator[i] += row[i];
+}
+
+static void scalar_sub_row(int16_t *accumulator, const int16_t *row) {
+    for (int i=0; i<NETWORK_HIDDEN; i++)
+        accumulator[i] -= row[i];
+}
+
+static void scalar_clip(const int16_t *input, uint8_t *output, int const count) {
+    for (int i=0; i<count; i++) {
+        int value = input[i];
+        output[i] = (value < 0) ? 0 : ((value > 127) ? 127 : value);
+    }
+}
+
+static void scalar_affine(const uint8_t *input, int const inputs, const int8_t *weights, const int32_t *bias, int32_t *output, int const outputs) {
+    for (int o=0; o<outputs; o++) {
+        int32_t sum = bias[o];
+        const int8_t *row = weights + o * inputs;
+        for (int i=0; i<inputs; i++)
+            sum += input[i] * row[i];
+        output[o] = sum;
+    }
+}
+
+
+
+/* AVX2 kernels, compiled for AVX2 only inside these functions so the rest of the program still runs on older CPUs. */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+static void avx2_add_row(int16_t *accumulator, const int16_t *row) {
+    for (int i=0; i<NETWORK_HIDDEN; i+=16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(accumulator + i));
+        __m256i w = _mm256_loadu_si256((const __m256i *)(row + i));
+        _mm256_storeu_si256((__m256i *)(accumulator + i), _mm256_add_epi16(a, w));
+    }
+}
+
+__attribute__((target("avx2")))
+static void avx2_sub_row(int16_t *accumulator, const int16_t *row) {
+    for (int i=0; i<NETWORK_HIDDEN; i+=16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(accumulator + i));
+        __m256i w = _mm256_loadu_si256((const __m256i *)(row + i));
+        _mm256_storeu_si256((__m256i *)(accumulator + i), _mm256_sub_epi16(a, w));
+    }
+}
+
+__attribute__((target("avx2")))
+static void avx2_clip(const int16_t *input, uint8_t *output, int const count) {
+    const __m256i max_value = _mm256_set1_epi8(127);
+    for (int i=0; i<count; i+=32) {
+        __m256i low = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i high = _mm256_loadu_si256((const __m256i *)(input + i + 16));
+        /* packus saturates to [0, 255] but interleaves the 128-bit lanes, so clamp to 127 and put the lanes back in order. */
+        __m256i packed = _mm256_min_epu8(_mm256_packus_epi16(low, high), max_value);
+        _mm256_storeu_si256((__m256i *)(output + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+}
+
+__attribute__((target("avx2")))
+static void avx2_affine(const uint8_t *input, int const inputs, const int8_t *weights, const int32_t *bias, int32_t *output, int const outputs) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int o=0; o<outputs; o++) {
+        const int8_t *row = weights + o * inputs;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i=0; i<inputs; i+=32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(input + i));
+            __m256i w = _mm256_loadu_si256((const __m256i *)(row + i));
+            /* Inputs are clipped to 127, so the pairwise 16-bit sums of maddubs never saturate. */
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        output[o] = bias[o] + _mm_cvtsi128_si32(half);
+    }
+}
+
+#endif
+
+
+
+/* The kernels used by this process, chosen once from the CPU features. */
+
+struct NetworkKernels {
+    const char *name;
+    void (*add_row)(int16_t *, const int16_t *);
+    void (*sub_row)(int16_t *, const int16_t *);
+    void (*clip)(const int16_t *, uint8_t *, int);
+    void (*affine)(const uint8_t *, int, const int8_t *, const int32_t *, int32_t *, int);
+};
+
+static NetworkKernels select_kernels() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+        return {"avx2", avx2_add_row, avx2_sub_row, avx2_clip, avx2_affine};
+#endif
+    return {"scalar", scalar_add_row, scalar_sub_row, scalar_clip, scalar_affine};
+}
+
+static const NetworkKernels &kernels() {
+    static const NetworkKernels selected = select_kernels();
+    return selected;
+}
+
+/* Clamp the hidden layer sums back to 8-bit activations for the next layer. */
+static void activate(const int32_t *sums, uint8_t *output, int const count) {
+    for (int i=0; i<count; i++) {
+        int32_t value = sums[i] >> ACTIVATION_SHIFT;
+        output[i] = (value < 0) ? 0 : ((value > 127) ? 127 : value);
+    }
+}
+
+
+
+ChessNetwork::ChessNetwork() : mapping(NULL), mapping_size(0) {}
+
+ChessNetwork::~ChessNetwork() {
+    unload();
+}
+
+void ChessNetwork::unload() {
+    if (mapping != NULL)
+        munmap(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+}
+
+bool ChessNetwork::loaded() const {
+    return mapping != NULL;
+}
+
+bool ChessNetwork::load(const char *path) {
+    unload();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (size_t(info.st_size) != NETWORK_FILE_SIZE)) {
+        close(fd);
+        return false;
+    }
+    void *address = mmap(NULL, NETWORK_FILE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    /* Check the header before pointing the layers into the mapping. */
+    const char *bytes = static_cast<const char *>(address);
+    uint32_t sizes[4];
+    memcpy(sizes, bytes + 8, sizeof(sizes));
+    if ((memcmp(bytes, NETWORK_MAGIC, 8) != 0) || (sizes[0] != NETWORK_FEATURES) || (sizes[1] != NETWORK_HIDDEN) || (sizes[2] != NETWORK_L1) || (sizes[3] != NETWORK_L2)) {
+        munmap(address, NETWORK_FILE_SIZE);
+        return false;
+    }
+
+    mapping = address;
+    mapping_size = NETWORK_FILE_SIZE;
+    feature_weights = reinterpret_cast<const int16_t *>(bytes + FEATURE_WEIGHTS_OFFSET);
+    feature_bias = reinterpret_cast<const int16_t *>(bytes + FEATURE_BIAS_OFFSET);
+    l1_weights = reinterpret_cast<const int8_t *>(bytes + L1_WEIGHTS_OFFSET);
+    l1_bias = reinterpret_cast<const int32_t *>(bytes + L1_BIAS_OFFSET);
+    l2_weights = reinterpret_cast<const int8_t *>(bytes + L2_WEIGHTS_OFFSET);
+    l2_bias = reinterpret_cast<const int32_t *>(bytes + L2_BIAS_OFFSET);
+    output_weights = reinterpret_cast<const int8_t *>(bytes + OUTPUT_WEIGHTS_OFFSET);
+    output_bias = reinterpret_cast<const int32_t *>(bytes + OUTPUT_BIAS_OFFSET);
+    return true;
+}
+
+bool ChessNetwork::write_random(const char *path, uint64_t const seed) {
+    char *bytes = new char[NETWORK_FILE_SIZE]();
+    memcpy(bytes, NETWORK_MAGIC, 8);
+    uint32_t sizes[4] = {NETWORK_FEATURES, NETWORK_HIDDEN, NETWORK_L1, NETWORK_L2};
+    memcpy(bytes + 8, sizes, sizeof(sizes));
+
+    /* xorshift64* generator, returning a value in [-range, range). */
+    uint64_t state = seed ? seed : 1;
+    auto next = [&state](int range) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return int((state * 0x2545F4914F6CDD1DULL) >> 40) % (2 * range) - range;
+    };
+
+    int16_t *ft_weights = reinterpret_cast<int16_t *>(bytes + FEATURE_WEIGHTS_OFFSET);
+    for (int i=0; i<NETWORK_FEATURES * NETWORK_HIDDEN; i++)
+        ft_weights[i] = next(32);
+    int16_t *ft_bias = reinterpret_cast<int16_t *>(bytes + FEATURE_BIAS_OFFSET);
+    for (int i=0; i<NETWORK_HIDDEN; i++)
+        ft_bias[i] = next(32);
+    int8_t *weights_1 = reinterpret_cast<int8_t *>(bytes + L1_WEIGHTS_OFFSET);
+    for (int i=0; i<NETWORK_L1 * 2 * NETWORK_HIDDEN; i++)
+        weights_1[i] = next(8);
+    int32_t *bias_1 = reinterpret_cast<int32_t *>(bytes + L1_BIAS_OFFSET);
+    for (int i=0; i<NETWORK_L1; i++)
+        bias_1[i] = next(1024);
+    int8_t *weights_2 = reinterpret_cast<int8_t *>(bytes + L2_WEIGHTS_OFFSET);
+    for (int i=0; i<NETWORK_L2 * NETWORK_L1; i++)
+        weights_2[i] = next(16);
+    int32_t *bias_2 = reinterpret_cast<int32_t *>(bytes + L2_BIAS_OFFSET);
+    for (int i=0; i<NETWORK_L2; i++)
+        bias_2[i] = next(1024);
+    int8_t *weights_out = reinterpret_cast<int8_t *>(bytes + OUTPUT_WEIGHTS_OFFSET);
+    for (int i=0; i<NETWORK_L2; i++)
+        weights_out[i] = next(32);
+
+    FILE *file = fopen(path, "wb");
+    bool written = (file != NULL) && (fwrite(bytes, 1, NETWORK_FILE_SIZE, file) == NETWORK_FILE_SIZE);
+    if (file != NULL)
+        written = (fclose(file) == 0) && written;
+    delete[] bytes;
+    return written;
+}
+
+int ChessNetwork::feature_index(int const perspective, bool const white_piece, int const type, int const square) {
+    /* From black's perspective the board is mirrored vertically and the teams are swapped, so both perspectives see "own" and "opponent" pieces. */
+    if (perspective == 0)
+        return ((white_piece ? 0 : 1) * 6 + type) * 64 + square;
+    return ((white_piece ? 1 : 0) * 6 + type) * 64 + (square ^ 56);
+}
+
+void ChessNetwork::refresh(NetworkAccumulator &accumulator, const int features[2][32], int const count) const {
+    for (int perspective=0; perspective<2; perspective++) {
+        memcpy(accumulator.values[perspective], feature_bias, sizeof(int16_t) * NETWORK_HIDDEN);
+        for (int i=0; i<count; i++)
+            kernels().add_row(accumulator.values[perspective], feature_weights + features[perspective][i] * NETWORK_HIDDEN);
+    }
+}
+
+void ChessNetwork::add_feature(NetworkAccumulator &accumulator, int const white_feature, int const black_feature) const {
+    kernels().add_row(accumulator.values[0], feature_weights + white_feature * NETWORK_HIDDEN);
+    kernels().add_row(accumulator.values[1], feature_weights + black_feature * NETWORK_HIDDEN);
+}
+
+void ChessNetwork::remove_feature(NetworkAccumulator &accumulator, int const white_feature, int const black_feature) const {
+    kernels().sub_row(accumulator.values[0], feature_weights + white_feature * NETWORK_HIDDEN);
+    kernels().sub_row(accumulator.values[1], feature_weights + black_feature * NETWORK_HIDDEN);
+}
+
+int ChessNetwork::evaluate(NetworkAccumulator const &accumulator, bool const white_to_move) const {
+    const NetworkKernels &k = kernels();
+    alignas(32) uint8_t input[2 * NETWORK_HIDDEN];
+    alignas(32) int32_t sums[NETWORK_L1];
+    alignas(32) uint8_t hidden_1[NETWORK_L1];
+    alignas(32) uint8_t hidden_2[NETWORK_L2];
+
+    /* The perspective of the team to move comes first. */
+    int us = white_to_move ? 0 : 1;
+    k.clip(accumulator.values[us], input, NETWORK_HIDDEN);
+    k.clip(accumulator.values[1 - us], input + NETWORK_HIDDEN, NETWORK_HIDDEN);
+
+    k.affine(input, 2 * NETWORK_HIDDEN, l1_weights, l1_bias, sums, NETWORK_L1);
+    activate(sums, hidden_1, NETWORK_L1);
+    k.affine(hidden_1, NETWORK_L1, l2_weights, l2_bias, sums, NETWORK_L2);
+    activate(sums, hidden_2, NETWORK_L2);
+    int32_t output;
+    k.affine(hidden_2, NETWORK_L2, output_weights, output_bias, &output, 1);
+    return output / OUTPUT_SCALE;
+}
+
+const char *ChessNetwork::kernel_name() {
+    return kernels().name;
+}
@@ -0,0 +1,94 @@
+#ifndef CHESSNETWORK_H
+#define CHESSNETWORK_H
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Efficiently updatable evaluation network (NNUE-style).
+The first layer maps 768 input features (team relative to the perspective x type of chess piece x square) to 256 values per perspective. Its output (the accumulator) only changes by one weight row for every chess piece added to or removed from the board, so it is updated incrementally as moves are made.
+The remaining layers (512 -> 32 -> 32 -> 1) run on 8-bit clipped activations with AVX2 kernels when the CPU supports them and a scalar fallback otherwise. Both give exactly the same result. */
+
+/* Sizes of the network layers. */
+const int NETWORK_FEATURES = 768;
+const int NETWORK_HIDDEN = 256;
+const int NETWORK_L1 = 32;
+const int NETWORK_L2 = 32;
+
+/* First layer output for both perspectives ([0] white, [1] black), kept by the board and updated incrementally. */
+struct NetworkAccumulator {
+    alignas(32) int16_t values[2][NETWORK_HIDDEN];
+};
+
+class ChessNetwork {
+    private:
+        /* Start and length of the memory mapped weights file. */
+        void *mapping;
+        size_t mapping_size;
+
+        /* Pointers into the mapping for the weights and biases of each layer. */
+        const int16_t *feature_weights;
+        const int16_t *feature_bias;
+        const int8_t *l1_weights;
+        const int32_t *l1_bias;
+        const int8_t *l2_weights;
+        const int32_t *l2_bias;
+        const int8_t *output_weights;
+        const int32_t *output_bias;
+
+        /* Release the current mapping if there is one. */
+        void unload();
+
+    public:
+        /* Default constructor that creates a network without weights (loaded() returns false until load() succeeds). */
+        ChessNetwork();
+
+        /* Destructor that unmaps the weights file. */
+        ~ChessNetwork();
+
+        ChessNetwork(ChessNetwork const &) = delete;
+        ChessNetwork &operator=(ChessNetwork const &) = delete;
+
+        /* Method that memory maps a weights file written by write_random() (or a trainer using the same layout).
+        @param path: the path of the weights file.
+        @return true if the file was mapped and has the expected header and size, false otherwise. */
+        bool load(const char *path);
+
+        /* @return true if weights are loaded. */
+        bool loaded() const;
+
+        /* Function that writes a network with pseudo random weights in the layout expected by load(), for benchmarks and testing.
+        @param path: the path of the file to write.
+        @param seed: seed of the pseudo random weights.
+        @return true if the file was written. */
+        static bool write_random(const char *path, uint64_t const seed);
+
+        /* Return the input feature index of a chess piece seen from one perspective (the board is mirrored vertically for black).
+        @param perspective: 0 for white, 1 for black.
+        @param white_piece: true if the chess piece belongs to the white team.
+        @param type: the type of chess piece (same order as ChessPiece's cptypes enum).
+        @param square: the square of the chess piece (rank * 8 + file). */
+        static int feature_index(int const perspective, bool const white_piece, int const type, int const square);
+
+        /* Method that recomputes the accumulator from scratch.
+        @param accumulator: the accumulator to fill.
+        @param features: the feature indices of every chess piece for each perspective.
+        @param count: the number of chess pieces. */
+        void refresh(NetworkAccumulator &accumulator, const int features[2][32], int const count) const;
+
+        /* Method that adds (or removes) one chess piece to the accumulator.
+        @param white_feature, black_feature: the feature index of the chess piece for each perspective (from feature_index()). */
+        void add_feature(NetworkAccumulator &accumulator, int const white_feature, int const black_feature) const;
+        void remove_feature(NetworkAccumulator &accumulator, int const white_feature, int const black_feature) const;
+
+        /* Method that runs the layers after the accumulator.
+        @param accumulator: an up to date accumulator.
+        @param white_to_move: true if the score is wanted for the white team.
+        @return the score in centipawns for the team to move. */
+        int evaluate(NetworkAccumulator const &accumulator, bool const white_to_move) const;
+
+        /* @return the name of the kernels selected for this CPU ("avx2" or "scalar"). */
+        static const char *kernel_name();
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "ChessBoard.h"
+#include "ChessNetwork.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+/* Benchmark for the evaluation network: compares evaluating each position of a game after an incremental accumulator update with evaluating it after a full refresh.
+Usage: nnue_bench [weights file] [rounds]. If the weights file cannot be loaded, a network with random weights is written there first. */
+
+/* Alekhine vs. Vasic (1931), the game played in ChessMain.cpp. */
+static const char *GAME[][2] = {
+    {"E2", "E4"}, {"E7", "E6"}, {"D2", "D4"}, {"D7", "D5"}, {"B1", "C3"}, {"F8", "B4"},
+    {"F1", "D3"}, {"B4", "C3"}, {"B2", "C3"}, {"H7", "H6"}, {"C1", "A3"}, {"B8", "D7"},
+    {"D1", "E2"}, {"D5", "E4"}, {"D3", "E4"}, {"G8", "F6"}, {"E4", "D3"}, {"B7", "B6"},
+    {"E2", "E6"}, {"F7", "E6"}, {"D3", "G6"}
+};
+
+/* Features added to and removed from the accumulator by one move. */
+struct FeatureDelta {
+    int added[2][4];
+    int removed[2][4];
+    int added_count;
+    int removed_count;
+};
+
+static void position_features(PackedPosition const &position, int features[2][32], int &count) {
+    count = 0;
+    for (int square=0; square<64; square++) {
+        int code = position.piece_at(square);
+        if (code < 0)
+            continue;
+        features[0][count] = ChessNetwork::feature_index(0, !(code & 8), code & 7, square);
+        features[1][count] = ChessNetwork::feature_index(1, !(code & 8), code & 7, square);
+        count++;
+    }
+}
+
+static FeatureDelta position_delta(PackedPosition const &before, PackedPosition const &after) {
+    FeatureDelta delta;
+    delta.added_count = 0;
+    delta.removed_count = 0;
+    for (int square=0; square<64; square++) {
+        int old_code = before.piece_at(square), new_code = after.piece_at(square);
+        if (old_code == new_code)
+            continue;
+        if (old_code >= 0) {
+            delta.removed[0][delta.removed_count] = ChessNetwork::feature_index(0, !(old_code & 8), old_code & 7, square);
+            delta.removed[1][delta.removed_count] = ChessNetwork::feature_index(1, !(old_code & 8), old_code & 7, square);
+            delta.removed_count++;
+        }
+        if (new_code >= 0) {
+            delta.added[0][delta.added_count] = ChessNetwork::feature_index(0, !(new_code & 8), new_code & 7, square);
+            delta.added[1][delta.added_count] = ChessNetwork::feature_index(1, !(new_code & 8), new_code & 7, square);
+            delta.added_count++;
+        }
+    }
+    return delta;
+}
+
+int main(int argc, char **argv) {
+    const char *path = (argc > 1) ? argv[1] : "network.nnue";
+    int rounds = (argc > 2) ? atoi(argv[2]) : 20000;
+
+    ChessNetwork network;
+    if (!network.load(path)) {
+        cout << "Writing a network with random weights to " << path << endl;
+        if (!ChessNetwork::write_random(path, 2024) || !network.load(path)) {
+            cerr << "Cannot load network " << path << endl;
+            return 1;
+        }
+    }
+    cout << "Network kernels: " << ChessNetwork::kernel_name() << endl;
+
+    /* Replay the game with the network attached (without printing the moves), keeping every position reached. */
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+    ChessBoard cb;
+    cb.attach_network(&network);
+    vector<PackedPosition> positions(1, cb.pack());
+    for (auto &move : GAME) {
+        cb.submitMove(move[0], move[1]);
+        positions.push_back(cb.pack());
+    }
+    cout.rdbuf(console);
+
+    /* The accumulator updated by every move made must match one computed from scratch. */
+    ChessBoard fresh(positions.back());
+    fresh.attach_network(&network);
+    bool consistent = (cb.evaluate() == fresh.evaluate());
+
+    /* Prepare the features of each position and the deltas between consecutive positions. */
+    int plies = positions.size() - 1;
+    vector<FeatureDelta> deltas;
+    vector<int> refreshed_scores;
+    for (int i=1; i<=plies; i++)
+        deltas.push_back(position_delta(positions[i-1], positions[i]));
+    NetworkAccumulator start;
+    int features[2][32], count;
+    position_features(positions[0], features, count);
+    network.refresh(start, features, count);
+
+    /* Full refresh and evaluation for every position. */
+    long long checksum = 0;
+    auto begin = chrono::steady_clock::now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=1; i<=plies; i++) {
+            NetworkAccumulator accumulator;
+            position_features(positions[i], features, count);
+            network.refresh(accumulator, features, count);
+            int score = network.evaluate(accumulator, positions[i].white_to_move());
+            checksum += score;
+            if (r == 0)
+                refreshed_scores.push_back(score);
+        }
+    }
+    double refresh_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    /* Incremental update and evaluation after every move. */
+    begin = chrono::steady_clock::now();
+    for (int r=0; r<rounds; r++) {
+        NetworkAccumulator accumulator = start;
+        for (int i=1; i<=plies; i++) {
+            FeatureDelta const &delta = deltas[i-1];
+            for (int j=0; j<delta.removed_count; j++)
+                network.remove_feature(accumulator, delta.removed[0][j], delta.removed[1][j]);
+            for (int j=0; j<delta.added_count; j++)
+                network.add_feature(accumulator, delta.added[0][j], delta.added[1][j]);
+            int score = network.evaluate(accumulator, positions[i].white_to_move());
+            checksum += score;
+            if ((r == 0) && (score != refreshed_scores[i-1]))
+                consistent = false;
+        }
+    }
+    double incremental_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    /* Accumulator work alone, without the layers after it. */
+    begin = chrono::steady_clock::now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=1; i<=plies; i++) {
+            NetworkAccumulator accumulator;
+            position_features(positions[i], features, count);
+            network.refresh(accumulator, features, count);
+            checksum += accumulator.values[0][r % NETWORK_HIDDEN];
+        }
+    }
+    double refresh_only_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    begin = chrono::steady_clock::now();
+    for (int r=0; r<rounds; r++) {
+        NetworkAccumulator accumulator = start;
+        for (int i=1; i<=plies; i++) {
+            FeatureDelta const &delta = deltas[i-1];
+            for (int j=0; j<delta.removed_count; j++)
+                network.remove_feature(accumulator, delta.removed[0][j], delta.removed[1][j]);
+            for (int j=0; j<delta.added_count; j++)
+                network.add_feature(accumulator, delta.added[0][j], delta.added[1][j]);
+        }
+        checksum += accumulator.values[0][r % NETWORK_HIDDEN];
+    }
+    double update_only_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    double evaluations = double(rounds) * plies;
+    printf("Positions per round:       %d\n", plies);
+    printf("Full refresh:              %.0f evaluations/s (%.1f ns each)\n", evaluations / refresh_seconds, 1e9 * refresh_seconds / evaluations);
+    printf("Incremental update:        %.0f evaluations/s (%.1f ns each)\n", evaluations / incremental_seconds, 1e9 * incremental_seconds / evaluations);
+    printf("Speed-up:                  %.2fx\n", refresh_seconds / incremental_seconds);
+    printf("Accumulator refresh only:  %.1f ns\n", 1e9 * refresh_only_seconds / evaluations);
+    printf("Accumulator update only:   %.1f ns\n", 1e9 * update_only_seconds / evaluations);
+    printf("Incremental == refresh:    %s\n", consistent ? "yes" : "NO");
+    /* Print the checksum so the timed loops cannot be optimised away. */
+    printf("Checksum:                  %lld\n", checksum);
+    return consistent ? 0 : 1;
+}
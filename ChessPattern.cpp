@@ -0,0 +1,339 @@
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "ChessPattern.h"
+#include "ChessBoard.h"
+#include "ChessGameFile.h"
+#include "ChessThreadPool.h"
+
+/* Number of corpus lines scanned by one task, and so the granularity at which matches stream out. The positions of a task are tested as one batch, which stays small enough for the cache. */
+static const size_t GAMES_PER_TASK = 64;
+
+static const uint64_t FILE_A = 0x0101010101010101ULL;
+static const uint64_t FILE_H = FILE_A << 7;
+static const uint64_t LIGHT_SQUARES = 0x55AA55AA55AA55AAULL;
+
+/* Return the number of bits set, with shifts, masks and adds only (no popcnt instruction or multiply), so that it also works on every lane of a vector register. */
+static inline uint64_t count_bits(uint64_t bits) {
+    bits -= (bits >> 1) & 0x5555555555555555ULL;
+    bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    bits += bits >> 8;
+    bits += bits >> 16;
+    bits += bits >> 32;
+    return bits & 0x7F;
+}
+
+/* Return 1 if a bitboard is not empty, else 0. Like count_bits() it uses no comparison, since plain x86-64 has no vector instruction comparing 64 bit words. */
+static inline uint64_t nonzero(uint64_t const bits) {
+    return (bits | (0 - bits)) >> 63;
+}
+
+/* Piece letters in piece code order (see PackedPosition::piece_codes), white then black. */
+static const char PIECE_LETTERS[] = "KQRBNP..kqrbnp";
+
+PositionBatch::PositionBatch() : size(0) {
+}
+
+void PositionBatch::assign(PackedPosition const *positions, size_t const count) {
+    for (int code=0; code<16; code++)
+        pieces[code].assign(count, 0);
+    white_to_move.resize(count);
+    for (size_t i=0; i<count; i++) {
+        uint64_t occupied = positions[i].words[0];
+        for (int n=0; occupied!=0; n++, occupied&=occupied-1) {
+            int code = int(positions[i].words[1 + n / 16] >> (4 * (n % 16))) & 15;
+            pieces[code][i] |= occupied & (0 - occupied);
+        }
+        white_to_move[i] = positions[i].white_to_move() ? 1 : 0;
+    }
+    size = count;
+}
+
+/* Return the squares of the pieces and every square below them on their files (towards rank 1), and above them (towards rank 8). */
+static inline uint64_t fill_down(uint64_t bits) {
+    bits |= bits >> 8;
+    bits |= bits >> 16;
+    return bits | (bits >> 32);
+}
+
+static inline uint64_t fill_up(uint64_t bits) {
+    bits |= bits << 8;
+    bits |= bits << 16;
+    return bits | (bits << 32);
+}
+
+/* Return the squares of a set together with the squares next to them on their rank. */
+static inline uint64_t widen(uint64_t const bits) {
+    return bits | ((bits >> 1) & ~FILE_H) | ((bits << 1) & ~FILE_A);
+}
+
+/* Return the passed pawns of each team: no enemy pawn ahead of them on their file or the files next to it. */
+static inline uint64_t white_passed(uint64_t const white_pawns, uint64_t const black_pawns) {
+    return white_pawns & ~widen(fill_down(black_pawns) >> 8);
+}
+
+static inline uint64_t black_passed(uint64_t const white_pawns, uint64_t const black_pawns) {
+    return black_pawns & ~widen(fill_up(white_pawns) << 8);
+}
+
+/* Return the piece code of a piece letter, or -1. */
+static int piece_code_of(char const letter) {
+    const char *found = (letter != '.') ? strchr(PIECE_LETTERS, letter) : NULL;
+    return ((found != NULL) && (letter != '\0')) ? int(found - PIECE_LETTERS) : -1;
+}
+
+bool ChessPattern::compile_term(string const &text) {
+    bool negated = !text.empty() && (text[0] == '!');
+    string term = negated ? text.substr(1) : text;
+    PatternTest test = {PatternTest::piece_count, 0, negated, ~0ULL, 0, 64};
+
+    /* Terms made of several tests cannot be negated as a whole. */
+    if (term == "rook_endgame")
+        return !negated && compile_term("only=KRPkrp") && compile_term("R>=1") && compile_term("r>=1");
+    if (term.compare(0, 5, "only=") == 0) {
+        if (negated)
+            return false;
+        for (size_t i=5; i<term.size(); i++) {
+            if (piece_code_of(term[i]) < 0)
+                return false;
+        }
+        for (int code=0; code<14; code++) {
+            if ((PIECE_LETTERS[code] == '.') || ((code & 7) == 0) || (term.find(PIECE_LETTERS[code], 5) != string::npos))
+                continue;
+            test.piece = code;
+            test.max = 0;
+            tests.push_back(test);
+        }
+        return true;
+    }
+
+    if ((term == "white") || (term == "black")) {
+        test.kind = PatternTest::side_to_move;
+        test.piece = (term == "white") ? PackedPosition::white_king : PackedPosition::black_king;
+    }
+    else if (term == "opposite_bishops")
+        test.kind = PatternTest::opposite_bishops;
+    else if ((term == "passed") || (term == "passed=w") || (term == "passed=b")) {
+        test.kind = PatternTest::passed_pawns;
+        test.piece = (term == "passed") ? 0xFF : ((term == "passed=w") ? PackedPosition::white_pawn : PackedPosition::black_pawn);
+    }
+    else {
+        int code = (term.size() >= 3) ? piece_code_of(term[0]) : -1;
+        if (code < 0)
+            return false;
+        test.piece = code;
+        int square = (term.size() == 3) ? square_from_name(term.c_str() + 1) : -1;
+        if (square >= 0) {
+            /* A piece on a square. */
+            test.mask = square_bit(square);
+            test.min = 1;
+        }
+        else {
+            /* A number of pieces: the operator, then digits only. */
+            size_t op_length = ((term[2] == '=') && ((term[1] == '<') || (term[1] == '>'))) ? 2 : 1;
+            string op = term.substr(1, op_length), number = term.substr(1 + op_length);
+            if (number.empty() || (number.size() > 2) || (number.find_first_not_of("0123456789") != string::npos))
+                return false;
+            int count = atoi(number.c_str());
+            if (op == "=")
+                test.min = test.max = count;
+            else if (op == "<")
+                test.max = count - 1;
+            else if (op == "<=")
+                test.max = count;
+            else if (op == ">")
+                test.min = count + 1;
+            else if (op == ">=")
+                test.min = count;
+            else
+                return false;
+            if (test.min > test.max)
+                return false;
+        }
+    }
+    tests.push_back(test);
+    return true;
+}
+
+bool ChessPattern::compile(string const &text, string &error) {
+    tests.clear();
+    error.clear();
+    string term;
+    for (size_t i=0; i<=text.size(); i++) {
+        char c = (i < text.size()) ? text[i] : ' ';
+        if ((c != ' ') && (c != ',') && (c != '\t')) {
+            term += c;
+            continue;
+        }
+        if (term.empty())
+            continue;
+        if (!compile_term(term)) {
+            error = term;
+            tests.clear();
+            return false;
+        }
+        term.clear();
+    }
+    return true;
+}
+
+vector<PatternTest> const &ChessPattern::compiled() const {
+    return tests;
+}
+
+void ChessPattern::match(PositionBatch const &batch, uint64_t *__restrict matches) const {
+    size_t size = batch.size;
+    for (size_t i=0; i<size; i++)
+        matches[i] = 1;
+
+    /* Every test is a loop over the positions with no branch on their contents, combining its result into matches. The arrays hold 64 bit words only and the tests use no 64 bit comparison, so every loop can be vectorized for plain x86-64 (ChessPattern.o is compiled with -O3 for that). */
+    for (PatternTest const &test : tests) {
+        uint64_t flip = test.negated ? 1 : 0;
+        uint64_t mask = test.mask;
+        switch (test.kind) {
+        case PatternTest::piece_count: {
+            uint64_t const *__restrict sets = batch.pieces[test.piece].data();
+            if ((test.min == 1) && (test.max >= 64)) {
+                for (size_t i=0; i<size; i++)
+                    matches[i] &= nonzero(sets[i] & mask) ^ flip;
+            }
+            else if (test.max == 0) {
+                for (size_t i=0; i<size; i++)
+                    matches[i] &= nonzero(sets[i] & mask) ^ flip ^ 1;
+            }
+            else {
+                /* The count is out of range when count - min or max - count is negative, which sets the top bit. */
+                uint64_t min = uint64_t(test.min), max = uint64_t(test.max);
+                for (size_t i=0; i<size; i++) {
+                    uint64_t count = count_bits(sets[i] & mask);
+                    matches[i] &= (((count - min) | (max - count)) >> 63) ^ flip ^ 1;
+                }
+            }
+            break;
+        }
+        case PatternTest::passed_pawns: {
+            uint64_t const *__restrict white_pawns = batch.pieces[PackedPosition::white_pawn].data();
+            uint64_t const *__restrict black_pawns = batch.pieces[PackedPosition::black_pawn].data();
+            uint64_t white = (test.piece != PackedPosition::black_pawn) ? ~0ULL : 0, black = (test.piece != PackedPosition::white_pawn) ? ~0ULL : 0;
+            for (size_t i=0; i<size; i++) {
+                uint64_t passed = (white & white_passed(white_pawns[i], black_pawns[i])) | (black & black_passed(white_pawns[i], black_pawns[i]));
+                matches[i] &= nonzero(passed) ^ flip;
+            }
+            break;
+        }
+        case PatternTest::opposite_bishops: {
+            uint64_t const *__restrict white_bishops = batch.pieces[PackedPosition::white_bishop].data();
+            uint64_t const *__restrict black_bishops = batch.pieces[PackedPosition::black_bishop].data();
+            for (size_t i=0; i<size; i++) {
+                uint64_t w = white_bishops[i], b = black_bishops[i];
+                uint64_t single = nonzero(w) & nonzero(b) & (nonzero((w & (w - 1)) | (b & (b - 1))) ^ 1);
+                matches[i] &= (single & (nonzero(w & LIGHT_SQUARES) ^ nonzero(b & LIGHT_SQUARES))) ^ flip;
+            }
+            break;
+        }
+        case PatternTest::side_to_move: {
+            uint64_t const *__restrict white_to_move = batch.white_to_move.data();
+            uint64_t white = (test.piece == PackedPosition::white_king) ? 1 : 0;
+            for (size_t i=0; i<size; i++)
+                matches[i] &= white_to_move[i] ^ white ^ flip ^ 1;
+            break;
+        }
+        }
+    }
+}
+
+bool scan_corpus(const char *corpus_path, ChessPattern const &pattern, int const thread_count, bool const first_only, function<void(PatternMatch const *, size_t)> const &on_matches, PatternScanStats &stats) {
+    stats.games = 0;
+    stats.positions = 0;
+    stats.matches = 0;
+    stats.rejected = 0;
+
+    CorpusFile corpus;
+    if (!corpus.open(corpus_path))
+        return false;
+    size_t task_count = corpus.block_count(GAMES_PER_TASK);
+
+    /* The matches of every block wait until the blocks before it have been passed on. */
+    vector<vector<PatternMatch>> results(task_count);
+    vector<bool> done(task_count, false);
+    size_t next_block = 0;
+    mutex output_lock;
+    atomic<uint64_t> games(0), positions(0), matched(0), rejected(0);
+    {
+        ChessThreadPool pool(thread_count);
+        vector<ChessBoard> boards(pool.size(), ChessBoard(PackedPosition::starting_position()));
+        vector<PositionBatch> batches(pool.size());
+        vector<vector<PackedPosition>> positions_played(pool.size());
+        vector<vector<uint64_t>> flags(pool.size());
+        for (size_t t=0; t<task_count; t++) {
+            pool.submit([&, t](int worker) {
+                ChessBoard &board = boards[worker];
+                PositionBatch &batch = batches[worker];
+                vector<PackedPosition> &replayed = positions_played[worker];
+                vector<uint64_t> &matches = flags[worker];
+                vector<PatternMatch> &found = results[t];
+                /* The corpus line of every game of the block, and the index of its first position in replayed (then the end of the last game). */
+                vector<uint32_t> game_lines;
+                vector<size_t> game_starts;
+                vector<ChessMove> moves;
+                GameResult result;
+                string line;
+                uint64_t task_games = 0, task_positions = 0, task_rejected = 0;
+                size_t first, end;
+                corpus.block_lines(t, GAMES_PER_TASK, first, end);
+                replayed.clear();
+                for (size_t game=first; game<end; game++) {
+                    if (!corpus.game_line(game, line))
+                        continue;
+                    task_games++;
+                    if (!read_game(line, moves, result)) {
+                        task_rejected++;
+                        continue;
+                    }
+                    /* The positions up to the first illegal move are still scanned. */
+                    game_lines.push_back(uint32_t(game));
+                    game_starts.push_back(replayed.size());
+                    if (replay_game(board, moves, replayed) != moves.size())
+                        task_rejected++;
+                }
+                game_starts.push_back(replayed.size());
+
+                /* The positions of the whole block are tested at once, then the matches are given back to their games. */
+                batch.assign(replayed.data(), replayed.size());
+                task_positions = batch.size;
+                matches.resize(batch.size);
+                pattern.match(batch, matches.data());
+                for (size_t g=0; g<game_lines.size(); g++) {
+                    for (size_t i=game_starts[g]; i<game_starts[g + 1]; i++) {
+                        if (matches[i] == 0)
+                            continue;
+                        found.push_back({game_lines[g], uint32_t(i - game_starts[g])});
+                        if (first_only)
+                            break;
+                    }
+                }
+                games += task_games;
+                positions += task_positions;
+                rejected += task_rejected;
+                matched += found.size();
+
+                lock_guard<mutex> guard(output_lock);
+                done[t] = true;
+                for (; (next_block < task_count) && done[next_block]; next_block++) {
+                    if (!results[next_block].empty())
+                        on_matches(results[next_block].data(), results[next_block].size());
+                    vector<PatternMatch>().swap(results[next_block]);
+                }
+            });
+        }
+        pool.wait();
+    }
+    corpus.close();
+    stats.games = games;
+    stats.positions = positions;
+    stats.matches = matched;
+    stats.rejected = rejected;
+    return true;
+}
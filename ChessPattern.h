@@ -0,0 +1,98 @@
+#ifndef CHESSPATTERN_H
+#define CHESSPATTERN_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ChessPosition.h"
+
+using namespace std;
+
+/* Positions in structure-of-arrays form (those of a block of games when scanning a corpus): pieces[code][i] is the bitboard of the chess pieces of piece code code (see PackedPosition::piece_codes) in position i, so a pattern test runs as one loop over a contiguous array per bitboard. */
+struct PositionBatch {
+    vector<uint64_t> pieces[16];
+    vector<uint64_t> white_to_move;
+    size_t size;
+
+    PositionBatch();
+
+    /* Method that replaces the positions of the batch, keeping its memory.
+    @param positions: the new positions.
+    @param count: the number of positions. */
+    void assign(PackedPosition const *positions, size_t const count);
+};
+
+/* One test of a compiled pattern; a position matches the pattern if it passes every test. */
+struct PatternTest {
+    /* piece_count: between min and max chess pieces of the piece code on the squares of mask. passed_pawns: a passed pawn of the team (piece is white_pawn or black_pawn). opposite_bishops: one bishop each, on squares of opposite colours. side_to_move: the team of piece is to move. */
+    enum test_kinds {piece_count, passed_pawns, opposite_bishops, side_to_move};
+
+    uint8_t kind;
+    uint8_t piece;
+    bool negated;
+    uint64_t mask;
+    int min;
+    int max;
+};
+
+/* Pattern over the chess pieces of a position, compiled from text into bitmask tests.
+Text: terms separated by spaces or commas, all of which must hold; a term starting with '!' must not hold. A term is one of:
+    Qd5             a piece on a square: letter KQRBNP for white, kqrbnp for black, then the square (either case)
+    R=2, p>=5, N<1  the number of pieces of a kind, with =, <, <=, > or >=
+    only=KRPkrp     no other kind of piece on the board (each letter a piece code as above; kings are always allowed)
+    passed, passed=w, passed=b      a passed pawn of either team, white or black
+    opposite_bishops                one bishop each, on squares of opposite colours
+    white, black                    the team to move
+    rook_endgame                    kings, rooks and pawns only, with a rook each
+For example "Qd5 opposite_bishops" or "rook_endgame passed". */
+class ChessPattern {
+    private:
+        vector<PatternTest> tests;
+
+        /* Function that compiles one term, appending its tests.
+        @return false if the term is not valid. */
+        bool compile_term(string const &term);
+
+    public:
+        /* Method that compiles a pattern, replacing the current one.
+        @param text: the pattern.
+        @param error: set to the term that is not valid, if any.
+        @return true if the whole pattern is valid. */
+        bool compile(string const &text, string &error);
+
+        /* @return the tests of the compiled pattern. */
+        vector<PatternTest> const &compiled() const;
+
+        /* Method that tests every position of a batch.
+        @param batch: the positions.
+        @param matches: set to 1 for every position matching the pattern and 0 for the others (batch.size entries). */
+        void match(PositionBatch const &batch, uint64_t *__restrict matches) const;
+};
+
+/* A position of a corpus that matches a pattern: the game (0-based line number in the corpus file) and the number of moves played before it. */
+struct PatternMatch {
+    uint32_t game;
+    uint32_t ply;
+};
+
+/* Counts reported by scan_corpus(). */
+struct PatternScanStats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t matches;
+    /* Games cut short at a move that is malformed or not legal under the board's rules (the positions before it are scanned). */
+    uint64_t rejected;
+};
+
+/* Function that replays every game of a corpus file (see ChessGameFile.h) with the board's rules and tests each position it reaches against a pattern. Blocks of games are scanned in parallel, each worker on its own board, and the matches of each block are passed to on_matches in corpus order as soon as the blocks before it are done, so they stream out while the scan goes on.
+@param corpus_path: the corpus file.
+@param pattern: the compiled pattern.
+@param thread_count: the number of threads.
+@param first_only: only report the first matching position of each game.
+@param on_matches: called (one call at a time) with the matches of each block.
+@param stats: set to the numbers of games, positions and matches.
+@return false if the corpus cannot be read. */
+bool scan_corpus(const char *corpus_path, ChessPattern const &pattern, int const thread_count, bool const first_only, function<void(PatternMatch const *, size_t)> const &on_matches, PatternScanStats &stats);
+
+#endif
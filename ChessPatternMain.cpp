@@ -0,0 +1,64 @@
+#include "ChessPattern.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/* Pattern query over a game corpus: prints the positions of the games that match a pattern.
+Usage: pattern_scan <corpus> <pattern> [-t threads] [-f] [-n max printed]
+Every game of the corpus (see ChessGameFile.h) is replayed with the board's rules and each position it reaches is tested against the pattern (see ChessPattern for its syntax, e.g. "rook_endgame passed" or "Qd5 !white"). Matches are printed as "game G ply P" lines (G the 0-based line of the game, P the number of moves played) as the scan goes on, in corpus order. With -f only the first matching position of each game is reported; -n stops printing after that many matches but the scan still counts them all. */
+
+static void usage() {
+    cerr << "Usage: pattern_scan <corpus> <pattern> [-t threads] [-f] [-n max printed]" << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    int threads = ChessThreadPool::hardware_threads();
+    bool first_only = false;
+    long long max_printed = -1;
+    for (int i=3; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-f") == 0)
+            first_only = true;
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            max_printed = atoll(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ChessPattern pattern;
+    string error;
+    if (!pattern.compile(argv[2], error)) {
+        cerr << "Invalid pattern term: " << error << endl;
+        return 1;
+    }
+
+    long long printed = 0;
+    PatternScanStats stats;
+    auto begin = chrono::steady_clock::now();
+    bool scanned = scan_corpus(argv[1], pattern, threads, first_only, [&](PatternMatch const *matches, size_t count) {
+        for (size_t i=0; (i<count) && ((max_printed < 0) || (printed < max_printed)); i++, printed++)
+            printf("game %u ply %u\n", matches[i].game, matches[i].ply);
+        fflush(stdout);
+    }, stats);
+    if (!scanned) {
+        cerr << "Cannot read " << argv[1] << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("%llu games (%llu rejected), %llu positions, %llu matches, %zu tests, %d thread(s)\n", (unsigned long long)stats.games, (unsigned long long)stats.rejected, (unsigned long long)stats.positions, (unsigned long long)stats.matches, pattern.compiled().size(), (threads < 1) ? 1 : threads);
+    printf("Scan %.3f s (%.0f positions/s, %.0f games/s)\n", seconds, (seconds > 0) ? stats.positions / seconds : 0.0, (seconds > 0) ? stats.games / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "ChessBoard.h"
+#include "ChessPawns.h"
+#include "ChessSearch.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+/* Benchmark for the pawn table: hit rate and time saved per evaluation by caching the pawn structure scores.
+Usage: pawn_bench [-g games] [-p plies] [-d walk depth] [-D search depth] [-e table entries] [-s seed]
+Positions are taken from random games. The move tree of each one is walked to the walk depth with make() and unmake(), scoring the pawns of every node twice: once through the table and once without it, checking that the scores are the same. The time per evaluation of both walks (the cost of the moves cancels out in their difference) gives the time saved by each probe. Then a search of the search depth is run from each position, with the pawn table of the search, and its hit rate reported. */
+
+static void usage() {
+    cerr << "Usage: pawn_bench [-g games] [-p plies] [-d walk depth] [-D search depth] [-e table entries] [-s seed]" << endl;
+}
+
+/* Walk the move tree of the board to the depth, adding the pawn score of every node (through the table, or worked out if it is NULL) to sum.
+@return the number of nodes scored. */
+static uint64_t walk(ChessBoard &board, int const depth, PawnTable *table, long long &sum) {
+    PawnScore score = board.pawn_score(table);
+    sum += score.structure * 31 + score.shield;
+    if (depth == 0)
+        return 1;
+    ChessMove moves[MAX_MOVES];
+    int count = board.legal_moves(moves);
+    uint64_t nodes = 1;
+    for (int i=0; i<count; i++) {
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        nodes += walk(board, depth - 1, table, sum);
+        board.unmake(moves[i], undo);
+    }
+    return nodes;
+}
+
+int main(int argc, char **argv) {
+    int games = 20, plies = 60, walk_depth = 3, search_depth = 4;
+    size_t entries = 16384;
+    uint64_t seed = 1;
+    for (int i=1; i<argc; i++) {
+        if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+            games = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+            plies = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+            walk_depth = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-D") == 0) && (i + 1 < argc))
+            search_depth = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-e") == 0) && (i + 1 < argc))
+            entries = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            seed = strtoull(argv[++i], NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    /* One position every 10 plies of each random game. */
+    vector<PackedPosition> positions;
+    uint64_t state = seed;
+    ChessBoard board(PackedPosition::starting_position());
+    board.set_output(NULL, NULL);
+    ChessMove legal[MAX_MOVES];
+    for (int game=0; game<games; game++) {
+        board.unpack(PackedPosition::starting_position());
+        for (int ply=0; ply<plies; ply++) {
+            int count = board.legal_moves(legal);
+            if (count == 0)
+                break;
+            if (ply % 10 == 9)
+                positions.push_back(board.pack());
+            board.play(legal[splitmix64(state) % count]);
+        }
+    }
+
+    PawnTable table(entries);
+    long long cached_sum = 0, computed_sum = 0;
+    uint64_t nodes = 0;
+    auto begin = chrono::steady_clock::now();
+    for (PackedPosition const &position : positions) {
+        board.unpack(position);
+        nodes += walk(board, walk_depth, &table, cached_sum);
+    }
+    double cached_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    begin = chrono::steady_clock::now();
+    for (PackedPosition const &position : positions) {
+        board.unpack(position);
+        walk(board, walk_depth, NULL, computed_sum);
+    }
+    double computed_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    printf("%zu positions, %llu nodes walked to depth %d\n", positions.size(), (unsigned long long)nodes, walk_depth);
+    printf("Pawn table (%zu entries): %llu probes, %.2f%% hits\n", entries, (unsigned long long)table.probes(), (table.probes() > 0) ? 100.0 * table.hits() / table.probes() : 0.0);
+    printf("Walk with the table: %.3f s (%.1f ns per node), without: %.3f s (%.1f ns per node), saved %.1f ns per evaluation\n", cached_seconds, cached_seconds * 1e9 / nodes, computed_seconds, computed_seconds * 1e9 / nodes, (computed_seconds - cached_seconds) * 1e9 / nodes);
+    printf("Scores %s\n", (cached_sum == computed_sum) ? "identical" : "DIFFERENT");
+
+    if (search_depth > 0) {
+        ChessSearch search(16);
+        SearchLimits limits = {search_depth, 0, 0};
+        atomic<bool> stop(false);
+        uint64_t searched = 0;
+        begin = chrono::steady_clock::now();
+        for (PackedPosition const &position : positions) {
+            board.unpack(position);
+            searched += search.search(board, limits, stop, ChessSearch::InfoCallback()).nodes;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        PawnTable const &pawns = search.pawn_table();
+        printf("Search to depth %d: %llu nodes in %.3f s, %llu pawn probes, %.2f%% hits\n", search_depth, (unsigned long long)searched, seconds, (unsigned long long)pawns.probes(), (pawns.probes() > 0) ? 100.0 * pawns.hits() / pawns.probes() : 0.0);
+    }
+    return (cached_sum == computed_sum) ? 0 : 1;
+}
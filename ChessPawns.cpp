@@ -0,0 +1,138 @@
+#include "ChessPawns.h"
+#include "ChessBitboard.h"
+
+/* Pawn structure scores in centipawns: penalties per doubled (each pawn beyond the first on a file), isolated and backward pawn, bonus per passed pawn by its rank counted from its own side, and bonus per shield pawn one and two ranks ahead of the king. */
+static const int DOUBLED_PENALTY = 12;
+static const int ISOLATED_PENALTY = 10;
+static const int BACKWARD_PENALTY = 8;
+static const int PASSED_BONUS[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+static const int SHIELD_NEAR_BONUS = 10;
+static const int SHIELD_FAR_BONUS = 5;
+
+static const uint64_t FILE_A = 0x0101010101010101ULL;
+
+/* Return the squares of a file, and of the files next to it. */
+static uint64_t file_squares(int const file) {
+    return FILE_A << file;
+}
+
+static uint64_t adjacent_files(int const file) {
+    return ((file > 0) ? file_squares(file - 1) : 0) | ((file < 7) ? file_squares(file + 1) : 0);
+}
+
+/* Return the squares of the ranks above a rank. */
+static uint64_t ranks_above(int const rank) {
+    return (rank < 7) ? ~0ULL << (8 * (rank + 1)) : 0;
+}
+
+/* Score of one team's pawns against the other's, with the team playing up the board (black's pawns are scored on the board flipped vertically). */
+static int side_structure(uint64_t const own, uint64_t const enemy) {
+    int score = 0;
+    for (int file=0; file<8; file++) {
+        int count = bit_count(own & file_squares(file));
+        if (count > 1)
+            score -= DOUBLED_PENALTY * (count - 1);
+    }
+
+    for (uint64_t pawns=own; pawns!=0; pawns&=pawns-1) {
+        int square = lowest_square(pawns);
+        int rank = square / 8, file = square % 8;
+        uint64_t ahead = ranks_above(rank);
+        uint64_t neighbours = own & adjacent_files(file);
+
+        /* Passed: no enemy pawn ahead on its file or the files next to it, and no own pawn in front of it. */
+        if (((enemy & (file_squares(file) | adjacent_files(file)) & ahead) == 0) && ((own & file_squares(file) & ahead) == 0)) {
+            score += PASSED_BONUS[rank];
+            continue;
+        }
+        if (neighbours == 0) {
+            score -= ISOLATED_PENALTY;
+            continue;
+        }
+        /* Backward: every neighbour is ahead of it, so none can come to defend it, and an enemy pawn stops it from advancing. */
+        if (((neighbours & ~ahead) == 0) && (rank < 7) && ((enemy & pawn_attacks(square + 8, true)) != 0))
+            score -= BACKWARD_PENALTY;
+    }
+    return score;
+}
+
+int PawnTable::evaluate_structure(uint64_t const white_pawns, uint64_t const black_pawns) {
+    return side_structure(white_pawns, black_pawns) - side_structure(__builtin_bswap64(black_pawns), __builtin_bswap64(white_pawns));
+}
+
+int PawnTable::evaluate_shield(uint64_t const own_pawns, int const king, bool const white) {
+    /* Look at black's king and pawns on the board flipped vertically, so both kings shelter up the board. */
+    uint64_t pawns = white ? own_pawns : __builtin_bswap64(own_pawns);
+    int square = white ? king : king ^ 56;
+    int rank = square / 8, file = square % 8;
+    if (rank > 1)
+        return 0;
+    uint64_t files = file_squares(file) | adjacent_files(file);
+    uint64_t near = files & (0xFFULL << (8 * (rank + 1)));
+    uint64_t far = files & (0xFFULL << (8 * (rank + 2)));
+    return SHIELD_NEAR_BONUS * bit_count(pawns & near) + SHIELD_FAR_BONUS * bit_count(pawns & far);
+}
+
+PawnScore PawnTable::evaluate(uint64_t const white_pawns, uint64_t const black_pawns, int const white_king, int const black_king) {
+    PawnScore score;
+    score.structure = evaluate_structure(white_pawns, black_pawns);
+    score.shield = evaluate_shield(white_pawns, white_king, true) - evaluate_shield(black_pawns, black_king, false);
+    return score;
+}
+
+PawnTable::PawnTable(size_t const entry_count) {
+    size_t size = 1;
+    while (size < entry_count)
+        size *= 2;
+    entries.resize(size);
+    mask = size - 1;
+    clear();
+}
+
+void PawnTable::clear() {
+    /* An empty entry has the key of the position without pawns, whose structure score is indeed 0; its king squares match no king, so its shields are worked out on first use. */
+    for (Entry &entry : entries) {
+        entry.key = 0;
+        entry.structure = 0;
+        entry.shield[0] = 0;
+        entry.shield[1] = 0;
+        entry.kings[0] = 0xFF;
+        entry.kings[1] = 0xFF;
+    }
+    probe_count = 0;
+    hit_count = 0;
+}
+
+PawnScore PawnTable::probe(uint64_t const key, uint64_t const white_pawns, uint64_t const black_pawns, int const white_king, int const black_king) {
+    Entry &entry = entries[key & mask];
+    probe_count++;
+    if (entry.key == key) {
+        hit_count++;
+    }
+    else {
+        entry.key = key;
+        entry.structure = evaluate_structure(white_pawns, black_pawns);
+        entry.kings[0] = 0xFF;
+        entry.kings[1] = 0xFF;
+    }
+    if (entry.kings[0] != white_king) {
+        entry.kings[0] = white_king;
+        entry.shield[0] = evaluate_shield(white_pawns, white_king, true);
+    }
+    if (entry.kings[1] != black_king) {
+        entry.kings[1] = black_king;
+        entry.shield[1] = evaluate_shield(black_pawns, black_king, false);
+    }
+    PawnScore score;
+    score.structure = entry.structure;
+    score.shield = entry.shield[0] - entry.shield[1];
+    return score;
+}
+
+uint64_t PawnTable::probes() const {
+    return probe_count;
+}
+
+uint64_t PawnTable::hits() const {
+    return hit_count;
+}
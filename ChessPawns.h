@@ -0,0 +1,62 @@
+#ifndef CHESSPAWNS_H
+#define CHESSPAWNS_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/* Pawn structure terms of the evaluation, in centipawns for white (negative favours black): doubled, isolated, backward and passed pawns, and the pawn shield in front of each king. */
+struct PawnScore {
+    int structure;
+    int shield;
+};
+
+/* Cache of pawn structure scores, keyed by the pawn-only Zobrist key of the position (ChessBoard::pawn_key(), which every move keeps up to date). Pawns move in few of the positions a search visits, so nearly every evaluation finds its pawn structure already scored.
+Each entry also keeps the shields of the last king squares it was probed with, as the kings move more often than the pawns. A table must only be used by one thread at a time (e.g. one per search). */
+class PawnTable {
+    private:
+        struct Entry {
+            uint64_t key;
+            int16_t structure;
+            int16_t shield[2];
+            uint8_t kings[2];
+        };
+
+        vector<Entry> entries;
+        size_t mask;
+        uint64_t probe_count;
+        uint64_t hit_count;
+
+    public:
+        /* Constructor that allocates the table.
+        @param entry_count: the number of entries, rounded up to a power of two (16 bytes each). */
+        explicit PawnTable(size_t const entry_count = 16384);
+
+        /* Method that empties the table and resets its counters. */
+        void clear();
+
+        /* Method that returns the pawn score of a position, from the table if its pawns are already scored.
+        @param key: the pawn-only key of the position.
+        @param white_pawns, black_pawns: the squares of the pawns of each team.
+        @param white_king, black_king: the squares of the kings.
+        @return the same score as evaluate(). */
+        PawnScore probe(uint64_t const key, uint64_t const white_pawns, uint64_t const black_pawns, int const white_king, int const black_king);
+
+        /* @return the number of probes, and of probes that found their pawn structure in the table. */
+        uint64_t probes() const;
+        uint64_t hits() const;
+
+        /* Function that scores the pawn structure of a position without the table. */
+        static int evaluate_structure(uint64_t const white_pawns, uint64_t const black_pawns);
+
+        /* Function that scores the pawn shield of a king: the pawns of its team on its file and the files next to it, one and two ranks ahead, while the king stays on its first 2 ranks.
+        @param white: the team of the king.
+        @return the score for the king's team (positive). */
+        static int evaluate_shield(uint64_t const own_pawns, int const king, bool const white);
+
+        /* Function that scores both terms without the table. */
+        static PawnScore evaluate(uint64_t const white_pawns, uint64_t const black_pawns, int const white_king, int const black_king);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "ChessPerft.h"
+#include "ChessThreadPool.h"
+
+/* Subtrees with at least this many plies left are split into one task per move instead of being counted by a single worker. */
+static const int PERFT_SPLIT_DEPTH = 5;
+
+PerftTable::PerftTable(size_t const megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+        count *= 2;
+    entries.reset(new Entry[count]);
+    for (size_t i=0; i<count; i++) {
+        entries[i].check.store(0, memory_order_relaxed);
+        entries[i].data.store(0, memory_order_relaxed);
+    }
+    mask = count - 1;
+}
+
+bool PerftTable::probe(uint64_t const key, int const depth, uint64_t &count) const {
+    /* The depth is mixed into the slot so the same position at different depths does not compete for one entry. */
+    Entry const &entry = entries[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & mask];
+    uint64_t data = entry.data.load(memory_order_relaxed);
+    uint64_t check = entry.check.load(memory_order_relaxed);
+    if (((check ^ data) != key) || (int(data & 0xFF) != depth))
+        return false;
+    count = data >> 8;
+    return true;
+}
+
+void PerftTable::store(uint64_t const key, int const depth, uint64_t const count) {
+    Entry &entry = entries[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & mask];
+    uint64_t data = (count << 8) | depth;
+    entry.check.store(key ^ data, memory_order_relaxed);
+    entry.data.store(data, memory_order_relaxed);
+}
+
+
+
+uint64_t perft(ChessBoard &board, int const depth, PerftTable *table) {
+    if (depth == 0)
+        return 1;
+
+    uint64_t key = 0, count = 0;
+    if ((table != NULL) && (depth >= 2)) {
+        key = board.position_key();
+        if (table->probe(key, depth, count))
+            return count;
+    }
+
+    ChessMove moves[MAX_MOVES];
+    int move_count = board.legal_moves(moves);
+    /* Bulk counting: the leaves one ply ahead are the legal moves themselves. */
+    if (depth == 1)
+        return move_count;
+
+    for (int i=0; i<move_count; i++) {
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        count += perft(board, depth - 1, table);
+        board.unmake(moves[i], undo);
+    }
+
+    if ((table != NULL) && (depth >= 2))
+        table->store(key, depth, count);
+    return count;
+}
+
+
+
+/* State shared by the tasks of one parallel_perft() call. */
+struct PerftJob {
+    ChessThreadPool *pool;
+    vector<ChessBoard> *boards;
+    PerftTable *table;
+    atomic<uint64_t> *root_counts;
+};
+
+/* Task counting the subtree of a position reached from root move root_index, either directly or by queueing one task per move. */
+static void perft_task(PerftJob const &job, PackedPosition const &position, int const depth, int const root_index, int const worker) {
+    ChessBoard &board = (*job.boards)[worker];
+    board.unpack(position);
+
+    if (depth < PERFT_SPLIT_DEPTH) {
+        job.root_counts[root_index] += perft(board, depth, job.table);
+        return;
+    }
+
+    /* Split: queue the positions after each move, to be picked up by this worker or stolen by idle ones. */
+    ChessMove moves[MAX_MOVES];
+    int move_count = board.legal_moves(moves);
+    for (int i=0; i<move_count; i++) {
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        PackedPosition child = board.pack();
+        board.unmake(moves[i], undo);
+        job.pool->submit([job, child, depth, root_index](int next_worker) {
+            perft_task(job, child, depth - 1, root_index, next_worker);
+        });
+    }
+}
+
+uint64_t parallel_perft(ChessBoard const &board, int const depth, int const thread_count, PerftTable *table, vector<PerftDivide> &divide) {
+    ChessBoard root(board);
+    root.attach_network(NULL);
+    ChessMove moves[MAX_MOVES];
+    int move_count = root.legal_moves(moves);
+
+    ChessThreadPool pool(thread_count);
+    vector<ChessBoard> boards(pool.size(), root);
+    unique_ptr<atomic<uint64_t>[]> root_counts(new atomic<uint64_t>[move_count]);
+    PerftJob job = {&pool, &boards, table, root_counts.get()};
+
+    /* One task per root move to begin with; the tasks split deeper subtrees themselves. */
+    for (int i=0; i<move_count; i++) {
+        root_counts[i] = 0;
+        ChessMoveUndo undo;
+        root.make(moves[i], undo);
+        PackedPosition child = root.pack();
+        root.unmake(moves[i], undo);
+        pool.submit([job, child, depth, i](int worker) {
+            perft_task(job, child, depth - 1, i, worker);
+        });
+    }
+    pool.wait();
+
+    uint64_t total = 0;
+    divide.clear();
+    for (int i=0; i<move_count; i++) {
+        PerftDivide entry = {moves[i], root_counts[i].load()};
+        divide.push_back(entry);
+        total += entry.count;
+    }
+    return total;
+}
@@ -0,0 +1,59 @@
+#ifndef CHESSPERFT_H
+#define CHESSPERFT_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Shared hash table memoising the leaf counts of subtrees by position key and depth. Entries are read and written without locks: each entry stores (key ^ data) next to data, so an entry torn by two threads writing at once does not match any key and is simply missed. */
+class PerftTable {
+    private:
+        struct Entry {
+            atomic<uint64_t> check;
+            atomic<uint64_t> data;
+        };
+        unique_ptr<Entry[]> entries;
+        size_t mask;
+
+    public:
+        /* Constructor that allocates the table (rounded down to a power of two number of entries).
+        @param megabytes: size of the table. */
+        explicit PerftTable(size_t const megabytes);
+
+        /* Method that looks up the leaf count of a position.
+        @param key: the position key.
+        @param depth: the remaining depth.
+        @param count: set to the stored leaf count if found.
+        @return true if the count was found. */
+        bool probe(uint64_t const key, int const depth, uint64_t &count) const;
+
+        /* Method that stores the leaf count of a position, replacing whatever was in its slot. */
+        void store(uint64_t const key, int const depth, uint64_t const count);
+};
+
+/* Leaf count of one root move. */
+struct PerftDivide {
+    ChessMove move;
+    uint64_t count;
+};
+
+/* Function that counts the leaf nodes of the legal move tree down to a given depth, using the board's own move rules.
+@param board: the position to start from (back to its original state on return).
+@param depth: the number of plies to look ahead.
+@param table: table to memoise subtree counts in, or NULL.
+@return the number of leaf nodes. */
+uint64_t perft(ChessBoard &board, int const depth, PerftTable *table);
+
+/* Function that counts the leaf nodes like perft(), splitting the tree at the root and at lower plies into tasks run on a work-stealing thread pool. Each worker plays on its own copy of the board. The totals are the same as those of perft().
+@param board: the position to start from.
+@param depth: the number of plies to look ahead (at least 1).
+@param thread_count: the number of worker threads.
+@param table: table shared by the workers to memoise subtree counts in, or NULL.
+@param divide: filled with the leaf count of each root move.
+@return the total number of leaf nodes. */
+uint64_t parallel_perft(ChessBoard const &board, int const depth, int const thread_count, PerftTable *table, vector<PerftDivide> &divide);
+
+#endif
@@ -0,0 +1,96 @@
+#include "ChessBoard.h"
+#include "ChessPerft.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+/* Perft "divide" from the starting position: prints the number of leaf nodes below each root move and the total.
+Usage: perft <depth> [-t threads] [-H hash megabytes] [--verify]
+-t 1 runs the serial counter, more threads run the parallel one (default: all hardware threads). -H 0 disables the shared hash table. --verify also runs the serial counter without a hash table and checks that the totals are identical. */
+
+static void usage() {
+    cerr << "Usage: perft <depth> [-t threads] [-H hash megabytes] [--verify]" << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    int depth = atoi(argv[1]);
+    int threads = ChessThreadPool::hardware_threads();
+    size_t hash_megabytes = 256;
+    bool verify = false;
+    for (int i=2; i<argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-H") == 0) && (i + 1 < argc))
+            hash_megabytes = atol(argv[++i]);
+        else if (strcmp(argv[i], "--verify") == 0)
+            verify = true;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (depth < 1) {
+        usage();
+        return 1;
+    }
+
+    /* Set up the starting position without printing the game start message. */
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+    ChessBoard cb;
+    cout.rdbuf(console);
+
+    unique_ptr<PerftTable> table;
+    if (hash_megabytes > 0)
+        table.reset(new PerftTable(hash_megabytes));
+
+    auto begin = chrono::steady_clock::now();
+    vector<PerftDivide> divide;
+    uint64_t total = 0;
+    if (threads <= 1) {
+        /* Serial divide on a single board. */
+        ChessMove moves[MAX_MOVES];
+        int move_count = cb.legal_moves(moves);
+        for (int i=0; i<move_count; i++) {
+            ChessMoveUndo undo;
+            cb.make(moves[i], undo);
+            PerftDivide entry = {moves[i], perft(cb, depth - 1, table.get())};
+            cb.unmake(moves[i], undo);
+            divide.push_back(entry);
+            total += entry.count;
+        }
+    }
+    else
+        total = parallel_perft(cb, depth, threads, table.get(), divide);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    for (auto &entry : divide) {
+        char from[3], to[3];
+        square_name(entry.move.from, from);
+        square_name(entry.move.to, to);
+        printf("%s%s: %llu\n", from, to, (unsigned long long)entry.count);
+    }
+    printf("\nDepth %d: %llu nodes with %d thread(s) in %.3f s (%.0f nodes/s)\n", depth, (unsigned long long)total, (threads < 1) ? 1 : threads, seconds, total / seconds);
+    printf("Sliding attacks indexed with %s\n", SLIDING_ATTACKS.pext ? "PEXT" : "magic multiplication");
+
+    if (verify) {
+        begin = chrono::steady_clock::now();
+        uint64_t serial_total = perft(cb, depth, NULL);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        printf("Serial without hash: %llu nodes in %.3f s, %s\n", (unsigned long long)serial_total, seconds, (serial_total == total) ? "identical" : "MISMATCH");
+        if (serial_total != total)
+            return 1;
+    }
+    return 0;
+}
@@ -8,7 +8,7 @@ bool ChessPiece::check_destination_team(int new_rank, int new_file, ChessBoard c
     /* if new position is occupied */
     if (new_position_piece != NULL) {
         /* if it is occupied by a piece of the same team */
-        if (this->get_team() == new_position_piece->get_team()) 
+        if (white == new_position_piece->white) 
             return false;
     }
     return true;
@@ -24,7 +24,7 @@ bool ChessPiece::valid_move(int old_rank, int old_file, int new_rank, int new_fi
         return false;
     }
     /* check if the move faces an obstacle along the way */
-    if (check_obstruction(old_rank, old_file, new_rank, new_file, chessboard.board)) {
+    if (check_obstruction(old_rank, old_file, new_rank, new_file, chessboard.occupied)) {
         return false;
     }
     return true;
@@ -70,6 +70,11 @@ void ChessPiece::increase_move_counter() {
     move_counter++;
 }
 
+bool ChessPiece::is_white() const {
+    /* compare colours with this rather than get_team(), which builds a string */
+    return white;
+}
+
 int ChessPiece::get_move_count() const {
     /* return the number of moves made by the chess piece */
     return move_counter;
@@ -92,18 +97,11 @@ ChessPiece::ChessPiece(char _team, cptypes _cptype) : cptype(_cptype)  {
 KingPiece::KingPiece(char _team) : ChessPiece(_team, king) {};
 
 bool KingPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* define the vertical distance (unsigned), horizontal distance (unsigned) and total distance (vertical + horizontal distance) moved by the king chess */
-    int vertical_distance, horizontal_distance, total_distance; 
-    vertical_distance = abs(old_rank-new_rank);
-    horizontal_distance = abs(old_file-new_file); 
-    total_distance = vertical_distance + horizontal_distance;
-    /* move is valid only if the vertical distance and horizontal distance are less than 2, and the total distance must add up to be either 2 (diagonal movement) or 1 (vertical/horizontal movement). */
-    if ((vertical_distance <= 1) && (horizontal_distance <= 1) && (total_distance <= 2) && (total_distance >= 1))
-        return true;
-    return false;
+    /* move is valid only if the destination square is one of the (up to 8) squares next to the source square */
+    return (SQUARE_TABLES.king[old_rank*8+old_file] & square_bit(new_rank*8+new_file)) != 0;
  }
 
- bool KingPiece::check_obstruction (int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
+ bool KingPiece::check_obstruction (int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
     /* always false as it moves only a square and the check_destination_team() source code would have captured any obstruction before this function is called. */
     return false;
  }
@@ -115,42 +113,13 @@ bool KingPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int
 RookPiece::RookPiece(char _team) : ChessPiece(_team, rook) {};
 
 bool RookPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* return true only when the rook piece is moving in the same rank (horizontally) or same file (vertically) */
-    if ((new_rank == old_rank) || (new_file == old_file))
-        return true;
-    return false;
+    /* return true only when the rook piece is moving in the same rank (horizontally) or same file (vertically), i.e. in one of the straight directions */
+    return SQUARE_TABLES.direction[old_rank*8+old_file][new_rank*8+new_file] < SquareTables::north_east;
 }
 
-bool RookPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* check if the chess piece faces any obstruction if it is moving rightwards along the same rank */
-    if ((new_rank == old_rank) && (new_file > old_file)) {
-        for (int i=old_file+1; i<new_file; i++) {
-            if (board[old_rank][i] != NULL)
-            return true;
-        }
-    }
-    /* check if the chess piece faces any obstruction if it is moving leftwards along the same rank */
-    else if ((new_rank == old_rank) && (new_file < old_file)) {
-        for (int i=old_file-1; i>new_file; i--) {
-            if (board[old_rank][i] != NULL)
-            return true;
-        }
-    }
-    /* check if the chess piece faces any obstruction if it is moving upwards along the same file */
-    else if ((new_file == old_file) && (new_rank > old_rank)) {
-        for (int i=old_rank+1; i<new_rank; i++) {
-            if (board[i][old_file] != NULL)
-            return true;
-        }
-    }
-    /* check if the chess piece faces any obstruction if it is moving downwards along the same file */
-    else if ((new_file == old_file) && (new_rank < old_rank)) {
-        for (int i=old_rank-1; i>new_rank; i--) {
-            if (board[i][old_file] != NULL)
-            return true;
-        }
-    }
-    return false;
+bool RookPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
+    /* the path is obstructed if the destination square is not among the squares the rook attacks with the current occupancy, i.e. a chess piece stands between the source and destination squares */
+    return !(rook_attacks(old_rank*8+old_file, occupied) & square_bit(new_rank*8+new_file));
 }
 
 
@@ -159,69 +128,15 @@ bool RookPiece::check_obstruction(int old_rank, int old_file, int new_rank, int
 
 BishopPiece::BishopPiece(char _team) : ChessPiece(_team, bishop) {};
 
-/* CHECK THIS: all directions ok? */
 bool BishopPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* return true only when the bishop piece moves diagonally (only when the vertical distance and the horizontal distance is the same) */
-    if (abs(old_rank-new_rank) == abs(old_file-new_file))
-        return true;
-    return false;
+    /* return true only when the bishop piece moves diagonally, i.e. in one of the diagonal directions */
+    uint8_t direction = SQUARE_TABLES.direction[old_rank*8+old_file][new_rank*8+new_file];
+    return (direction >= SquareTables::north_east) && (direction != SquareTables::no_direction);
 }
 
-bool BishopPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    int i = old_rank, j = old_file;
-    /* checks for obstruction when the bishop piece moves to a higher rank and higher file */
-    if ((old_rank < new_rank) && (old_file < new_file)) {
-        /* move in advance to next sqaure */
-        i++;
-        j++;
-        while ((i!=new_rank) && (j!=new_file)) {
-            if (board[i][j] != NULL) {
-                return true;
-            }
-            i++;
-            j++;
-        }
-    }
-    /* checks for obstruction when the bishop piece moves to a higher rank and lower file */
-    else if ((old_rank < new_rank) && (old_file > new_file)) {
-        /* move in advance to next sqaure */
-        i++;
-        j--;
-        while ((i!=new_rank) && (j!=new_file)) {
-            if (board[i][j] != NULL) {
-                return true;
-            }
-            i++;
-            j--;
-        }
-    }
-    /* checks for obstruction when the bishop piece moves to a lower rank and lower file */
-    else if ((old_rank > new_rank) && (old_file > new_file)) {
-        /* move in advance to next sqaure */
-        i--;
-        j--;
-        while ((i!=new_rank) && (j!=new_file)) {
-            if (board[i][j] != NULL) {
-                return true;
-            }
-            i--;
-            j--;
-        }
-    }
-    /* checks for obstruction when the bishop piece moves to a lower rank and higher file */
-    else if ((old_rank > new_rank) && (old_file < new_file)) {
-        /* move in advance to next sqaure */
-        i--;
-        j++;
-        while ((i!=new_rank) && (j!=new_file)) {
-            if (board[i][j] != NULL) {
-                return true;
-            }
-            i--;
-            j++;
-        }
-    }
-    return false;
+bool BishopPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
+    /* checks for obstruction on the squares between the source and destination squares along the diagonal, by looking up the squares the bishop attacks */
+    return !(bishop_attacks(old_rank*8+old_file, occupied) & square_bit(new_rank*8+new_file));
 }
 
 
@@ -231,90 +146,15 @@ bool BishopPiece::check_obstruction(int old_rank, int old_file, int new_rank, in
 QueenPiece::QueenPiece(char _team) : ChessPiece(_team, queen) {};
 
 bool QueenPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* Check to ensure that the move is strictly diagonal (vertical distance == horizontal distance), vertical (new_rank == old_rank) and horizontal (new_file == old_file) */
-    if ((abs(old_rank-new_rank) == abs(old_file-new_file)) || ((new_rank == old_rank) || (new_file == old_file)))
-        /* it is valid if the check above passes. */
-        return true;
-    return false;
+    /* Check to ensure that the move is along a rank, file or diagonal (any direction in the table) */
+    return SQUARE_TABLES.direction[old_rank*8+old_file][new_rank*8+new_file] != SquareTables::no_direction;
 }
 
- bool QueenPiece::check_obstruction (int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* Following 26 lines uses rook piece's method to check for obstruction if the queen piece was moved similarly to a rook piece (refer to RookPiece's check_obstruction() method for full description). */
-    if ((old_rank == new_rank) || (old_file == new_file)) {
-        if ((new_rank == old_rank) && (new_file > old_file)) {
-            for (int i=old_file+1; i<new_file; i++) {
-                if (board[old_rank][i] != NULL)
-                return true;
-            }
-        }
-        else if ((new_rank == old_rank) && (new_file < old_file)) {
-            for (int i=old_file-1; i>new_file; i--) {
-                if (board[old_rank][i] != NULL)
-                return true;
-            }
-        }
-        else if ((new_file == old_file) && (new_rank > old_rank)) {
-            for (int i=old_rank+1; i<new_rank; i++) {
-                if (board[i][old_file] != NULL)
-                return true;
-            }
-        }
-        else if ((new_file == old_file) && (new_rank < old_rank)) {
-            for (int i=old_rank-1; i>new_rank; i--) {
-                if (board[i][old_file] != NULL)
-                return true;
-            }
-        }
-    }
-    /* Following 50 lines uses bishop piece's method to check for obstruction if the queen piece was moved similarly to a bishop piece (refer to BishopPiece's check_obstruction() method for full description). */
-    if (abs(old_rank-new_rank) == abs(old_file-new_file)) {
-        int i = old_rank, j = old_file;
-        if ((old_rank < new_rank) && (old_file < new_file)) {
-            i++;
-            j++;
-            while ((i!=new_rank) && (j!=new_file)) {
-                if (board[i][j] != NULL) {
-                    return true;
-                }
-                i++;
-                j++;
-            }
-        }
-        else if ((old_rank < new_rank) && (old_file > new_file)) {
-            i++;
-            j--;
-            while ((i!=new_rank) && (j!=new_file)) {
-                if (board[i][j] != NULL) {
-                    return true;
-                }
-                i++;
-                j--;
-            }
-        }
-        else if ((old_rank > new_rank) && (old_file > new_file)) {
-            i--;
-            j--;
-            while ((i!=new_rank) && (j!=new_file)) {
-                if (board[i][j] != NULL) {
-                    return true;
-                }
-                i--;
-                j--;
-            }
-        }
-        else if ((old_rank > new_rank) && (old_file < new_file)) {
-            i--;
-            j++;
-            while ((i!=new_rank) && (j!=new_file)) {
-                if (board[i][j] != NULL) {
-                    return true;
-                }
-                i--;
-                j++;
-            }
-        }
-    }
-    return false;
+ bool QueenPiece::check_obstruction (int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
+    /* Look up the attacks of a rook or a bishop on the source square, depending on whether the queen moves straight or diagonally. */
+    int old_square = old_rank*8+old_file, new_square = new_rank*8+new_file;
+    uint64_t attacks = (SQUARE_TABLES.direction[old_square][new_square] < SquareTables::north_east) ? rook_attacks(old_square, occupied) : bishop_attacks(old_square, occupied);
+    return !(attacks & square_bit(new_square));
  }
 
 
@@ -324,16 +164,11 @@ bool QueenPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int
 KnightPiece::KnightPiece(char _team) : ChessPiece(_team, knight) {};
 
 bool KnightPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* Returns true if the knight piece moves 2 squares vertically and 1 square horizontally. */
-    if ((abs(old_rank-new_rank) == 2) && (abs(old_file-new_file) == 1))
-        return true;
-    /* Returns true if the knight piece moves 1 square vertically and 2 squares horizontally. */
-    if ((abs(old_rank-new_rank) == 1) && (abs(old_file-new_file) == 2))
-        return true;
-    return false;
+    /* Returns true if the knight piece moves 2 squares in one direction and 1 square in the other, i.e. to one of its precomputed jump squares. */
+    return (SQUARE_TABLES.knight[old_rank*8+old_file] & square_bit(new_rank*8+new_file)) != 0;
 }
 
-bool KnightPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
+bool KnightPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
     /* Always return false as there is no obstruction for knight piece. */
     return false; 
 }
@@ -345,66 +180,27 @@ bool KnightPiece::check_obstruction(int old_rank, int old_file, int new_rank, in
 PawnPiece::PawnPiece(char _team) : ChessPiece(_team, pawn) {};
 
 bool PawnPiece::check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* Check that is the piece at the new position, as it is allowed to move diagonally if it is occupied by an opponent's piece. */
+    int old_square = old_rank*8+old_file, new_square = new_rank*8+new_file;
+    /* Check that is the piece at the new position, as it is allowed to move diagonally forwards (one of its attacked squares) if it is occupied by an opponent's piece. */
     const ChessPiece * new_position_piece = board[new_rank][new_file];
-    /* Perform the next 2 checks if the new position has a chess piece */
-    if (new_position_piece != NULL) {
-        /* For white pawn piece: check if the new position moves diagonally up (1 square horizontally and vertically) from original position and there is a black team chess piece there */
-        if (white) {
-            if ((abs(new_rank-old_rank) == 1) && (abs(new_file-old_file) == 1) && (new_rank > old_rank) && !(new_position_piece->get_team() == "White") ) {
-                return true;
-                }
-        }
-
-        /* For black pawn piece: check if the new position move diagonally down (1 square horizontally and vertically) from original position and there is a white team chess piece there */
-        if (!white) {
-            if ((abs(old_rank-new_rank) == 1) && (abs(new_file-old_file) == 1) && (new_rank < old_rank) && (new_position_piece->get_team() == "White")) {
-                return true;
-                }
-        }
-    }
+    if ((new_position_piece != NULL) && (SQUARE_TABLES.pawn_attacks[white ? 0 : 1][old_square] & square_bit(new_square)) && (new_position_piece->is_white() != white))
+        return true;
 
-    /* if the above conditions are not met, the pawn piece will have to stay within the file */
-    if (old_file == new_file) {
-        /* For white pawn piece: check if the new position is one position up */
-        if ((new_rank == old_rank+1) && (white)) {
-            return true;
-        }
-        /* For black pawn picec: check if the new position is one position down */
-        if ((new_rank == old_rank-1) && !(white)) {
-            return true;
-        }
-        /* For white pawn piece: if the move is it's first move, check if the new position is two position up */
-        if ((move_counter == 0) && (new_rank == old_rank+2) && (white)) {
-            return true;
-        }
-        /* For black pawn piece: if the move is it's first move, check if the new position is two position down */
-        if ((move_counter == 0) && (new_rank == old_rank-2) && !(white)) {
-            return true;
-        }
-    }
+    /* if the above conditions are not met, the pawn piece will have to move one square forwards (up for white, down for black) within the file, or two squares on its first move */
+    int step = new_square - old_square, forward = white ? 8 : -8;
+    if (step == forward)
+        return true;
+    if ((move_counter == 0) && (step == 2*forward))
+        return true;
     return false;
 }
 
-bool PawnPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const {
-    /* return true if there is no obstruction for white pawn when it is moving up from the source square to the destination square. */
-    if ((white) && (old_file == new_file)) {
-        for (int i=old_rank+1; i<=new_rank; i++) {
-            if (board[i][old_file] != NULL) {
-                return true;
-            }
-        }
-    }
-    /* return true if there is no obstruction for black pawn when it is moving down from the source square to the destination square. */
-    if (!(white) && (old_file == new_file)){
-        for (int i=old_rank-1; i>=new_rank; i--) {
-            if (board[i][old_file] != NULL) {
-                return true;
-            }
-        }
-    }
-
-    return false; 
+bool PawnPiece::check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const {
+    /* diagonal captures cannot be obstructed */
+    if (old_file != new_file)
+        return false;
+    /* return true if there is an obstruction for the pawn moving along its file, including the destination square as pawns do not capture forwards. */
+    return (occupied & (square_bit(new_rank*8+new_file) | SQUARE_TABLES.between[old_rank*8+old_file][new_rank*8+new_file])) != 0;
 }
 
 
@@ -43,8 +43,9 @@ class ChessPiece {
         /* Virtual method 2: Run through the movement path of the chess piece and check for obstruction. 
         @param: old_rank, old_file represents the original rank and file of the chess piece
         @param: new_rank, new_file represents the new rank and file of the chess piece submitted
-        @return True if there is obstruction in the path, False if there is no obstruction in the path */
-        virtual bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const = 0;
+        @param: occupied: the squares holding a chess piece (ChessBoard::occupied), from which the sliding pieces look up the squares they attack (SLIDING_ATTACKS)
+        @return True if there is obstruction in the path, False if there is no obstruction in the path (only meaningful for a move that passes check_piece_logic()) */
+        virtual bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const = 0;
         
         /* Method check if 1) the destination square is not occupied by a piece that belongs to the same team (check_destination_team()), 
         2) the move from the source square to the destination square obeys the piece's movement logic (check_piece_logic()),
@@ -54,7 +55,7 @@ class ChessPiece {
         @oaram ChessBoard: the current configuration of chessboard. 
         @return true all of the 3 conditions above are met, false otherwise. */
         bool valid_move(int old_rank, int old_file, int new_rank, int new_file, ChessBoard const &chessboard) const;
-        
+
         /* Method to increase counter tracked by the variable 'move_counter' after every move made by the chess piece. */
         void increase_move_counter();
 
@@ -68,9 +69,13 @@ class ChessPiece {
         virtual ~ChessPiece() = default;
 
     public:
+        /* Names of the chess piece type ("King", "Queen", ...) and team ("White" or "Black"), for messages only: the rules compare cptype and is_white(), which do not build strings. */
         string get_cptype() const;
         
         string get_team() const;
+
+        /* @return true if the chess piece belongs to the white team. */
+        bool is_white() const;
         
         int get_move_count() const;
 
@@ -89,7 +94,7 @@ class KingPiece : private ChessPiece {
         /* For this and the remaining subclasses of ChessPiece, refer to the virtual function check_piece_logic() found under abstract class chess piece for full description. */
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
         /* Function returns false all the time as the king only moves 1 square at a time. The only possible obstruction occurs when the king piece moves to a destination square that contains it's own team chess piece, which would have been detected by the check_destination_team() method of the base class. */
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 
@@ -100,7 +105,7 @@ class RookPiece : private ChessPiece {
         RookPiece(char _team);
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
         /* For this and the remaining subclasses of ChessPiece (except knight), refer to the virtual function check_obstruction() found under abstract class chess piece for full description. */
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 
@@ -110,7 +115,7 @@ class BishopPiece : private ChessPiece {
     private:
         BishopPiece(char _team);
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 
@@ -120,7 +125,7 @@ class QueenPiece : private ChessPiece {
     private:
         QueenPiece(char _team);
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 
@@ -132,7 +137,7 @@ class KnightPiece : private ChessPiece {
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
         /* Function that checks obstruction for knight piece. 
         @return false all the time because it can leap over all pieces */
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 
@@ -142,7 +147,7 @@ class PawnPiece : private ChessPiece {
     private:
         PawnPiece(char _team);
         bool check_piece_logic(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
-        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, const ChessPiece *const board[8][8]) const override;
+        bool check_obstruction(int old_rank, int old_file, int new_rank, int new_file, uint64_t const occupied) const override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <cstring>
+#include "ChessPosition.h"
+
+static constexpr PositionKeys make_position_keys() {
+    PositionKeys keys = {};
+    uint64_t state = 0x4368657373426F61ULL;
+    for (int code=0; code<16; code++) {
+        for (int square=0; square<64; square++)
+            keys.pieces[code][square] = splitmix64(state);
+    }
+    keys.white_to_move = splitmix64(state);
+    /* A key per single castling right, combined with xor for every set of rights. */
+    uint64_t single_rights[4] = {splitmix64(state), splitmix64(state), splitmix64(state), splitmix64(state)};
+    for (int rights=0; rights<16; rights++) {
+        keys.castling[rights] = 0;
+        for (int i=0; i<4; i++) {
+            if (rights & (1 << i))
+                keys.castling[rights] ^= single_rights[i];
+        }
+    }
+    return keys;
+}
+
+extern constexpr PositionKeys POSITION_KEYS = make_position_keys();
+
+int PackedPosition::piece_count() const {
+    /* every occupied square holds exactly one chess piece */
+    return __builtin_popcountll(words[0]);
+}
+
+int PackedPosition::piece_at(int const square) const {
+    uint64_t square_bit = 1ULL << square;
+    /* return -1 if the square is empty */
+    if (!(words[0] & square_bit))
+        return -1;
+    /* the nibble index is the number of occupied squares below the square asked for */
+    int index = __builtin_popcountll(words[0] & (square_bit - 1));
+    return (words[1 + index / 16] >> ((index % 16) * 4)) & 0xF;
+}
+
+bool PackedPosition::white_to_move() const {
+    return words[3] & 1;
+}
+
+int PackedPosition::castling() const {
+    return (words[3] >> 1) & 0xF;
+}
+
+uint64_t PackedPosition::key() const {
+    uint64_t position_key = POSITION_KEYS.castling[castling()];
+    if (white_to_move())
+        position_key ^= POSITION_KEYS.white_to_move;
+    uint64_t occupancy = words[0];
+    int index = 0;
+    while (occupancy) {
+        int square = __builtin_ctzll(occupancy);
+        occupancy &= occupancy - 1;
+        int code = (words[1 + index / 16] >> ((index % 16) * 4)) & 0xF;
+        position_key ^= POSITION_KEYS.pieces[code][square];
+        index++;
+    }
+    return position_key;
+}
+
+/* Letters of the piece codes in FEN (white pieces upper case), indexed by piece code. */
+static const char FEN_LETTERS[] = "KQRBNP??kqrbnp??";
+
+bool PackedPosition::from_fen(string const &fen, PackedPosition &position) {
+    int codes[64];
+    for (int square=0; square<64; square++)
+        codes[square] = -1;
+
+    /* Piece placement: ranks 8 to 1 separated by '/', digits for runs of empty squares. */
+    size_t i = 0;
+    int rank = 7, file = 0, kings[2] = {0, 0}, pieces = 0;
+    for (; (i < fen.size()) && (fen[i] != ' '); i++) {
+        char c = fen[i];
+        if (c == '/') {
+            if ((file != 8) || (rank == 0))
+                return false;
+            rank--;
+            file = 0;
+        }
+        else if ((c >= '1') && (c <= '8')) {
+            file += c - '0';
+            if (file > 8)
+                return false;
+        }
+        else {
+            const char *letter = (c != '?') ? strchr(FEN_LETTERS, c) : NULL;
+            if ((letter == NULL) || (c == '\0') || (file > 7))
+                return false;
+            int code = letter - FEN_LETTERS;
+            codes[rank * 8 + file] = code;
+            if ((code & 7) == 0)
+                kings[code >> 3]++;
+            pieces++;
+            file++;
+        }
+    }
+    if ((rank != 0) || (file != 8) || (kings[0] != 1) || (kings[1] != 1) || (pieces > 32))
+        return false;
+
+    /* Side to move (white if left out). */
+    while ((i < fen.size()) && (fen[i] == ' '))
+        i++;
+    bool white = true;
+    if (i < fen.size()) {
+        if (fen[i] == 'b')
+            white = false;
+        else if (fen[i] != 'w')
+            return false;
+        i++;
+    }
+
+    /* Castling rights, kept only when the king and rook are where castling needs them. */
+    while ((i < fen.size()) && (fen[i] == ' '))
+        i++;
+    int rights = 0;
+    for (; (i < fen.size()) && (fen[i] != ' '); i++) {
+        switch (fen[i]) {
+            case 'K':
+                if ((codes[4] == white_king) && (codes[7] == white_rook))
+                    rights |= white_king_side;
+                break;
+            case 'Q':
+                if ((codes[4] == white_king) && (codes[0] == white_rook))
+                    rights |= white_queen_side;
+                break;
+            case 'k':
+                if ((codes[60] == black_king) && (codes[63] == black_rook))
+                    rights |= black_king_side;
+                break;
+            case 'q':
+                if ((codes[60] == black_king) && (codes[56] == black_rook))
+                    rights |= black_queen_side;
+                break;
+            case '-':
+                break;
+            default:
+                return false;
+        }
+    }
+
+    PackedPosition packed = {{0, 0, 0, 0}};
+    int index = 0;
+    for (int square=0; square<64; square++) {
+        if (codes[square] < 0)
+            continue;
+        packed.words[0] |= 1ULL << square;
+        packed.words[1 + index / 16] |= uint64_t(codes[square]) << ((index % 16) * 4);
+        index++;
+    }
+    packed.words[3] = (white ? 1 : 0) | (rights << 1);
+    position = packed;
+    return true;
+}
+
+string PackedPosition::to_fen() const {
+    string fen;
+    for (int rank=7; rank>=0; rank--) {
+        int empty = 0;
+        for (int file=0; file<8; file++) {
+            int code = piece_at(rank * 8 + file);
+            if (code < 0) {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+                fen += char('0' + empty);
+            empty = 0;
+            fen += FEN_LETTERS[code];
+        }
+        if (empty > 0)
+            fen += char('0' + empty);
+        if (rank > 0)
+            fen += '/';
+    }
+    fen += white_to_move() ? " w " : " b ";
+    int rights = castling();
+    if (rights == 0)
+        fen += '-';
+    if (rights & white_king_side)
+        fen += 'K';
+    if (rights & white_queen_side)
+        fen += 'Q';
+    if (rights & black_king_side)
+        fen += 'k';
+    if (rights & black_queen_side)
+        fen += 'q';
+    fen += " - 0 1";
+    return fen;
+}
+
+PackedPosition PackedPosition::starting_position() {
+    PackedPosition position;
+    from_fen(STARTING_FEN, position);
+    return position;
+}
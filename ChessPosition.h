@@ -0,0 +1,113 @@
+#ifndef CHESSPOSITION_H
+#define CHESSPOSITION_H
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+/* Canonical 32-byte encoding of a board position, small enough to hold tens of millions of positions in memory and usable directly as a key in hash sets and sorted arrays.
+Two positions that allow exactly the same moves for the rest of the game pack to the same value, so the encoding can be compared with == and < for deduplication. */
+struct PackedPosition {
+    /* Piece codes stored in the nibbles: the low 3 bits hold the piece type (same order as ChessPiece's cptypes enum) and bit 3 is set for black pieces. */
+    enum piece_codes {white_king, white_queen, white_rook, white_bishop, white_knight, white_pawn, black_king = 8, black_queen, black_rook, black_bishop, black_knight, black_pawn};
+
+    /* Castling rights held in the flag word (a right exists while the king and the rook on that side have not moved yet). */
+    enum castling_rights {white_king_side = 1, white_queen_side = 2, black_king_side = 4, black_queen_side = 8};
+
+    /* words[0]: occupancy bitboard, bit (rank * 8 + file) is set when the square holds a chess piece.
+    words[1], words[2]: one 4-bit piece code per occupied square, in increasing square order starting from the lowest nibble of words[1] (at most 32 pieces).
+    words[3]: bit 0 is set when it is white's turn, bits 1 to 4 hold the castling rights. All other bits are always zero so that the encoding stays canonical. */
+    uint64_t words[4];
+
+    /* Return the number of chess pieces on the board. */
+    int piece_count() const;
+
+    /* Return the piece code of the square (rank * 8 + file), or -1 if the square is empty. */
+    int piece_at(int const square) const;
+
+    /* Return true if it is white's turn in the packed position. */
+    bool white_to_move() const;
+
+    /* Return the castling rights (combination of the castling_rights enum) of the packed position. */
+    int castling() const;
+
+    /* Return the 64-bit Zobrist key of the packed position (the same value ChessBoard::position_key() returns for the board it packs). */
+    uint64_t key() const;
+
+    /* Function that reads a position in Forsyth-Edwards Notation. Only the piece placement, side to move and castling fields are used (the rules have no en passant, and the move clocks do not matter); the side to move and castling fields may be left out. Castling rights whose king or rook is not on its starting square are dropped.
+    @param fen: the FEN string.
+    @param position: set to the position read.
+    @return true if the placement is valid (8 ranks of 8 squares, one king per team, at most 32 chess pieces), false otherwise. */
+    static bool from_fen(string const &fen, PackedPosition &position);
+
+    /* Return the position in Forsyth-Edwards Notation (en passant "-", half move clock 0 and move number 1). */
+    string to_fen() const;
+
+    /* Return the starting position of a game (STARTING_FEN). */
+    static PackedPosition starting_position();
+};
+
+/* The starting position of a game in Forsyth-Edwards Notation. */
+const char STARTING_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/* Random keys combined with xor into a 64-bit position key (Zobrist hashing): one key per piece code and square, one for white to move and one per set of castling rights. The table is generated at compile time so it needs no initialisation at run time. */
+struct PositionKeys {
+    uint64_t pieces[16][64];
+    uint64_t white_to_move;
+    uint64_t castling[16];
+};
+
+extern const PositionKeys POSITION_KEYS;
+
+/* Output function of the splitmix64 generator: mixes the bits of a value so that close values give unrelated results (also used on its own to hash a few numbers together). */
+constexpr uint64_t splitmix64_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Step of the splitmix64 generator: fast, with a 64-bit state and the same sequence on every platform.
+@param state: the state of the generator, advanced by the step.
+@return the next number. */
+constexpr uint64_t splitmix64(uint64_t &state) {
+    state += 0x9E3779B97F4A7C15ULL;
+    return splitmix64_mix(state);
+}
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+inline bool operator==(PackedPosition const &lhs, PackedPosition const &rhs) {
+    return (lhs.words[0] == rhs.words[0]) && (lhs.words[1] == rhs.words[1]) && (lhs.words[2] == rhs.words[2]) && (lhs.words[3] == rhs.words[3]);
+}
+
+inline bool operator!=(PackedPosition const &lhs, PackedPosition const &rhs) {
+    return !(lhs == rhs);
+}
+
+/* Lexicographic order over the four words, for sorted arrays and binary search. */
+inline bool operator<(PackedPosition const &lhs, PackedPosition const &rhs) {
+    for (int i=0; i<4; i++) {
+        if (lhs.words[i] != rhs.words[i])
+            return lhs.words[i] < rhs.words[i];
+    }
+    return false;
+}
+
+namespace std {
+    /* Hash of a packed position, so it can be used directly as the key of unordered containers. */
+    template<> struct hash<PackedPosition> {
+        size_t operator()(PackedPosition const &position) const {
+            uint64_t h = 0;
+            for (int i=0; i<4; i++) {
+                /* mix each word in with a multiply-xorshift round */
+                h = (h ^ position.words[i]) * 0x9E3779B97F4A7C15ULL;
+                h ^= h >> 32;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+}
+
+#endif
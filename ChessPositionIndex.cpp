@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ChessPositionIndex.h"
+#include "ChessBoard.h"
+#include "ChessGameFile.h"
+#include "ChessThreadPool.h"
+
+static const char INDEX_MAGIC[9] = "CHESSIX1";
+
+/* Entries are bucketed by the top 16 bits of their key. */
+static const int INDEX_BUCKETS = 1 << 16;
+static const int INDEX_BUCKET_SHIFT = 48;
+
+/* Magic, entry count and bucket offsets. */
+static const size_t INDEX_HEADER_SIZE = 16 + (INDEX_BUCKETS + 1) * sizeof(uint64_t);
+
+/* Number of corpus lines replayed by one task. */
+static const size_t GAMES_PER_TASK = 4096;
+
+/* Number of entries buffered before the merge writes them to the file. */
+static const size_t WRITE_BUFFER_ENTRIES = 1 << 16;
+
+PositionIndex::PositionIndex() : mapping(NULL), mapping_size(0), buckets(NULL), entries(NULL), count(0) {}
+
+PositionIndex::~PositionIndex() {
+    unload();
+}
+
+void PositionIndex::unload() {
+    if (mapping != NULL)
+        munmap(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+    buckets = NULL;
+    entries = NULL;
+    count = 0;
+}
+
+bool PositionIndex::loaded() const {
+    return mapping != NULL;
+}
+
+uint64_t PositionIndex::size() const {
+    return count;
+}
+
+bool PositionIndex::load(const char *path) {
+    unload();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (size_t(info.st_size) < INDEX_HEADER_SIZE)) {
+        close(fd);
+        return false;
+    }
+    size_t file_size = info.st_size;
+    void *address = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    /* Check the header and that the file holds exactly the entries it announces. */
+    const char *bytes = static_cast<const char *>(address);
+    uint64_t entry_count;
+    memcpy(&entry_count, bytes + 8, sizeof(entry_count));
+    const uint64_t *offsets = reinterpret_cast<const uint64_t *>(bytes + 16);
+    if ((memcmp(bytes, INDEX_MAGIC, 8) != 0) || (file_size != INDEX_HEADER_SIZE + entry_count * sizeof(IndexEntry)) || (offsets[INDEX_BUCKETS] != entry_count)) {
+        munmap(address, file_size);
+        return false;
+    }
+
+    mapping = address;
+    mapping_size = file_size;
+    buckets = offsets;
+    entries = reinterpret_cast<const IndexEntry *>(bytes + INDEX_HEADER_SIZE);
+    count = entry_count;
+    return true;
+}
+
+size_t PositionIndex::lookup(uint64_t const key, IndexEntry const *&first) const {
+    if (!loaded()) {
+        first = NULL;
+        return 0;
+    }
+    /* The bucket narrows the search down to the entries sharing the top bits of the key. */
+    IndexEntry const *begin = entries + buckets[key >> INDEX_BUCKET_SHIFT];
+    IndexEntry const *end = entries + buckets[(key >> INDEX_BUCKET_SHIFT) + 1];
+    IndexEntry lowest = {key, 0, 0}, highest = {key, UINT32_MAX, UINT32_MAX};
+    first = lower_bound(begin, end, lowest);
+    return upper_bound(first, end, highest) - first;
+}
+
+
+
+/* Function that replays one game with replay_game(), appending the keys of the positions it reaches to run.
+@param replayed: scratch buffer for the packed positions.
+@return false if the game stopped at a move that is not legal. */
+static bool index_game(ChessBoard &board, vector<ChessMove> const &moves, uint32_t const game, vector<PackedPosition> &replayed, vector<IndexEntry> &run) {
+    replayed.clear();
+    size_t played = replay_game(board, moves, replayed);
+    for (size_t ply=0; ply<replayed.size(); ply++)
+        run.push_back({replayed[ply].key(), game, uint32_t(ply)});
+    return played == moves.size();
+}
+
+bool PositionIndex::build(const char *corpus_path, const char *index_path, int const thread_count, IndexBuildStats &stats) {
+    stats.games = 0;
+    stats.positions = 0;
+    stats.rejected = 0;
+
+    CorpusFile corpus;
+    if (!corpus.open(corpus_path))
+        return false;
+
+    /* Replay and sort blocks of games in parallel, each worker on its own board. */
+    size_t task_count = corpus.block_count(GAMES_PER_TASK);
+    vector<vector<IndexEntry>> runs(task_count);
+    atomic<uint64_t> games(0), rejected(0);
+    {
+        ChessThreadPool pool(thread_count);
+        vector<ChessBoard> boards(pool.size(), ChessBoard(PackedPosition::starting_position()));
+        for (size_t t=0; t<task_count; t++) {
+            pool.submit([&, t](int worker) {
+                ChessBoard &board = boards[worker];
+                vector<IndexEntry> &run = runs[t];
+                vector<PackedPosition> replayed;
+                vector<ChessMove> moves;
+                GameResult result;
+                string line;
+                uint64_t task_games = 0, task_rejected = 0;
+                size_t first, end;
+                corpus.block_lines(t, GAMES_PER_TASK, first, end);
+                for (size_t game=first; game<end; game++) {
+                    if (!corpus.game_line(game, line))
+                        continue;
+                    task_games++;
+                    if (!read_game(line, moves, result) || !index_game(board, moves, game, replayed, run))
+                        task_rejected++;
+                }
+                sort(run.begin(), run.end());
+                games += task_games;
+                rejected += task_rejected;
+            });
+        }
+        pool.wait();
+    }
+    corpus.close();
+    stats.games = games;
+    stats.rejected = rejected;
+
+    FILE *file = fopen(index_path, "wb");
+    if (file == NULL)
+        return false;
+    vector<uint64_t> offsets(INDEX_BUCKETS + 1, 0);
+    bool written = fwrite(offsets.data(), 1, 16, file) == 16;
+    written = written && (fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size());
+
+    /* Merge the sorted runs into the file, counting the entries of each bucket on the way. */
+    typedef pair<IndexEntry, size_t> Head;
+    auto later = [](Head const &lhs, Head const &rhs) { return rhs.first < lhs.first; };
+    priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+    vector<size_t> positions(task_count, 0);
+    for (size_t t=0; t<task_count; t++) {
+        if (!runs[t].empty())
+            heads.push(Head(runs[t][0], t));
+    }
+    vector<IndexEntry> buffer;
+    buffer.reserve(WRITE_BUFFER_ENTRIES);
+    uint64_t total = 0;
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        buffer.push_back(head.first);
+        offsets[(head.first.key >> INDEX_BUCKET_SHIFT) + 1]++;
+        total++;
+        size_t t = head.second;
+        if (++positions[t] < runs[t].size())
+            heads.push(Head(runs[t][positions[t]], t));
+        else
+            vector<IndexEntry>().swap(runs[t]);
+        if (buffer.size() == WRITE_BUFFER_ENTRIES) {
+            written = written && (fwrite(buffer.data(), sizeof(IndexEntry), buffer.size(), file) == buffer.size());
+            buffer.clear();
+        }
+    }
+    written = written && (fwrite(buffer.data(), sizeof(IndexEntry), buffer.size(), file) == buffer.size());
+
+    /* Turn the bucket counts into offsets and fill in the header. */
+    for (int b=0; b<INDEX_BUCKETS; b++)
+        offsets[b + 1] += offsets[b];
+    written = written && (fseek(file, 0, SEEK_SET) == 0);
+    written = written && (fwrite(INDEX_MAGIC, 1, 8, file) == 8) && (fwrite(&total, sizeof(total), 1, file) == 1);
+    written = written && (fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size());
+    written = (fclose(file) == 0) && written;
+    stats.positions = total;
+    return written;
+}
@@ -0,0 +1,82 @@
+#ifndef CHESSPOSITIONINDEX_H
+#define CHESSPOSITIONINDEX_H
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/* One position reached in a game of the corpus: the position key (PackedPosition::key()), the game (0-based line number in the corpus file) and the number of moves played before the position (0 for the starting position). */
+struct IndexEntry {
+    uint64_t key;
+    uint32_t game;
+    uint32_t ply;
+};
+
+inline bool operator<(IndexEntry const &lhs, IndexEntry const &rhs) {
+    if (lhs.key != rhs.key)
+        return lhs.key < rhs.key;
+    if (lhs.game != rhs.game)
+        return lhs.game < rhs.game;
+    return lhs.ply < rhs.ply;
+}
+
+/* Counts reported by PositionIndex::build(). */
+struct IndexBuildStats {
+    uint64_t games;
+    uint64_t positions;
+    /* Games cut short at a move that is malformed or not legal under the board's rules (the positions before it are indexed). */
+    uint64_t rejected;
+};
+
+/* Sorted on-disk index from position keys to the games and plies reaching them, memory mapped for lookups.
+File layout: the magic "CHESSIX1", the number of entries (uint64), a table of INDEX_BUCKETS + 1 entry offsets (uint64) where offset b is the first entry whose key has b as its top 16 bits, then the entries sorted by key, game and ply. A lookup reads one bucket offset pair and binary searches the few entries in between. */
+class PositionIndex {
+    private:
+        /* Start and length of the memory mapped index file. */
+        void *mapping;
+        size_t mapping_size;
+
+        const uint64_t *buckets;
+        const IndexEntry *entries;
+        uint64_t count;
+
+        /* Release the current mapping if there is one. */
+        void unload();
+
+    public:
+        /* Default constructor that creates an empty index (loaded() returns false until load() succeeds). */
+        PositionIndex();
+
+        /* Destructor that unmaps the index file. */
+        ~PositionIndex();
+
+        PositionIndex(PositionIndex const &) = delete;
+        PositionIndex &operator=(PositionIndex const &) = delete;
+
+        /* Method that memory maps an index file written by build().
+        @param path: the path of the index file.
+        @return true if the file was mapped and has the expected header and size, false otherwise. */
+        bool load(const char *path);
+
+        /* @return true if an index is loaded. */
+        bool loaded() const;
+
+        /* @return the number of entries (positions reached, counted once per game and ply). */
+        uint64_t size() const;
+
+        /* Method that finds every game and ply reaching a position.
+        @param key: the position key.
+        @param first: set to the first matching entry (entries are sorted by game, then ply).
+        @return the number of matching entries, which follow each other from first. */
+        size_t lookup(uint64_t const key, IndexEntry const *&first) const;
+
+        /* Function that replays every game of a corpus file (ChessGameFile.h format) with the board's rules and writes the index of all the positions reached. Blocks of games are replayed and sorted in parallel on a thread pool, then merged into the file.
+        @param corpus_path: the corpus file to read.
+        @param index_path: the index file to write.
+        @param thread_count: the number of worker threads.
+        @param stats: set to the number of games, positions and rejected games.
+        @return true if the corpus could be read and the index written. */
+        static bool build(const char *corpus_path, const char *index_path, int const thread_count, IndexBuildStats &stats);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include "ChessSan.h"
+
+/* Piece letters, indexed by piece type (same order as ChessPiece's cptypes enum). Pawns have none. */
+static const char PIECE_LETTERS[6] = {'K', 'Q', 'R', 'B', 'N', 0};
+
+static const int KING = 0, PAWN = 5;
+
+/* Return the square of the king of a team, or -1 if it has none. */
+static int king_square(ChessBoard const &board, bool const white) {
+    int code = white ? PackedPosition::white_king : PackedPosition::black_king;
+    for (int square=0; square<64; square++) {
+        if (board.piece_at(square) == code)
+            return square;
+    }
+    return -1;
+}
+
+bool read_san(ChessBoard &board, string_view const san, ChessMove &move) {
+    /* Check, mate and annotation suffixes carry no information about the move. */
+    size_t length = san.size();
+    while ((length > 0) && ((san[length - 1] == '+') || (san[length - 1] == '#') || (san[length - 1] == '!') || (san[length - 1] == '?')))
+        length--;
+    string_view text = san.substr(0, length);
+    bool white = board.white_to_move();
+
+    /* Castling is a king move of 2 squares along its rank. */
+    bool king_side = (text == "O-O") || (text == "0-0");
+    if (king_side || (text == "O-O-O") || (text == "0-0-0")) {
+        int from = king_square(board, white);
+        if (from < 0)
+            return false;
+        int to = from + (king_side ? 2 : -2);
+        if ((to / 8 != from / 8) || !(board.legal_destinations(from) & square_bit(to)))
+            return false;
+        move.from = from;
+        move.to = to;
+        return true;
+    }
+
+    /* Optional piece letter, optional source file and rank, optional capture sign, then the destination square. */
+    if (length < 2)
+        return false;
+    int to = square_from_name(text.data() + length - 2);
+    if (to < 0)
+        return false;
+    int type = PAWN;
+    size_t i = 0;
+    for (int t=KING; t<PAWN; t++) {
+        if ((length > 2) && (text[0] == PIECE_LETTERS[t])) {
+            type = t;
+            i = 1;
+        }
+    }
+    int from_file = -1, from_rank = -1;
+    bool capture = false;
+    for (; i<length-2; i++) {
+        char c = text[i];
+        if ((c >= 'a') && (c <= 'h') && (from_file < 0) && (from_rank < 0) && !capture)
+            from_file = c - 'a';
+        else if ((c >= '1') && (c <= '8') && (from_rank < 0) && !capture)
+            from_rank = c - '1';
+        else if (((c == 'x') || (c == ':')) && !capture)
+            capture = true;
+        else
+            return false;
+    }
+    if (capture && (board.piece_at(to) < 0))
+        return false;
+    /* A pawn stays on its file unless it captures, and then its file is always written. */
+    if ((type == PAWN) && (from_file < 0))
+        from_file = to % 8;
+
+    /* The move must be legal for exactly one chess piece matching the letter and disambiguation. */
+    int code = white ? type : type + PackedPosition::black_king;
+    int found = 0;
+    for (int square=0; square<64; square++) {
+        if ((board.piece_at(square) != code) || ((from_file >= 0) && (square % 8 != from_file)) || ((from_rank >= 0) && (square / 8 != from_rank)))
+            continue;
+        if (board.legal_destinations(square) & square_bit(to)) {
+            move.from = square;
+            move.to = to;
+            found++;
+        }
+    }
+    return found == 1;
+}
+
+size_t write_san(ChessBoard &board, ChessMove const &move, char san[SAN_LENGTH]) {
+    int code = board.piece_at(move.from);
+    int type = code & 7;
+    size_t length = 0;
+
+    if ((type == KING) && (abs(move.to % 8 - move.from % 8) == 2)) {
+        const char *castling = (move.to > move.from) ? "O-O" : "O-O-O";
+        while (castling[length] != '\0') {
+            san[length] = castling[length];
+            length++;
+        }
+    }
+    else {
+        bool capture = board.piece_at(move.to) >= 0;
+        if (type != PAWN) {
+            san[length++] = PIECE_LETTERS[type];
+            /* Look for other chess pieces of the same kind that can move to the same square. */
+            bool ambiguous = false, same_file = false, same_rank = false;
+            for (int square=0; square<64; square++) {
+                if ((square != move.from) && (board.piece_at(square) == code) && (board.legal_destinations(square) & square_bit(move.to))) {
+                    ambiguous = true;
+                    same_file = same_file || (square % 8 == move.from % 8);
+                    same_rank = same_rank || (square / 8 == move.from / 8);
+                }
+            }
+            if (ambiguous && (!same_file || same_rank))
+                san[length++] = 'a' + move.from % 8;
+            if (ambiguous && same_file)
+                san[length++] = '1' + move.from / 8;
+        }
+        else if (capture)
+            san[length++] = 'a' + move.from % 8;
+        if (capture)
+            san[length++] = 'x';
+        san[length++] = 'a' + move.to % 8;
+        san[length++] = '1' + move.to / 8;
+    }
+
+    /* Check or mate suffix, from the position after the move. */
+    ChessMoveUndo undo;
+    board.make(move, undo);
+    if (board.in_check()) {
+        ChessMove replies[MAX_MOVES];
+        san[length++] = (board.legal_moves(replies) > 0) ? '+' : '#';
+    }
+    board.unmake(move, undo);
+    san[length] = '\0';
+    return length;
+}
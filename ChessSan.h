@@ -0,0 +1,28 @@
+#ifndef CHESSSAN_H
+#define CHESSSAN_H
+#include <cstddef>
+#include <string_view>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Standard algebraic notation (SAN) of moves, e.g. "Nbd7", "exd5", "O-O", "Qxe6+", for the rules of ChessBoard (no promotion and no en passant, so "=Q" suffixes and "e.p." are not accepted). */
+
+/* Size of a buffer that holds any move written by write_san(), terminating '\0' included (e.g. "Qa1xb2#"). */
+const int SAN_LENGTH = 8;
+
+/* Function that reads a move in SAN for the team to move. The moving chess piece is found among the legal moves of the position (from ChessBoard::legal_destinations(), so reading several moves of the same position generates its moves only once), and must be the only one matching the piece letter and disambiguation. Castling may be written with letters or zeros ("O-O", "0-0-0"); the capture sign is optional, and check, mate and annotation suffixes ("+", "#", "!", "?") are ignored. Nothing is allocated.
+@param board: the position (not changed).
+@param san: the move.
+@param move: set to the move read.
+@return true if san names exactly one legal move. */
+bool read_san(ChessBoard &board, string_view const san, ChessMove &move);
+
+/* Function that writes a legal move in SAN, with the shortest disambiguation needed (file, then rank, then both) and a "+" or "#" suffix when it checks or mates.
+@param board: the position before the move (changed while the move is simulated, back to its original state on return).
+@param move: a legal move.
+@param san: buffer of at least SAN_LENGTH characters, set to the '\0' terminated move.
+@return the length of the move written. */
+size_t write_san(ChessBoard &board, ChessMove const &move, char san[SAN_LENGTH]);
+
+#endif
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include "ChessSearch.h"
+
+/* Values of the piece codes (low 3 bits: king, queen, rook, bishop, knight, pawn) used to order captures. */
+static const int ORDER_VALUES[8] = {0, 900, 500, 300, 300, 100, 0, 0};
+
+/* The time limit is checked once every this many nodes (the stop flag at every node). */
+static const uint64_t TIME_CHECK_INTERVAL = 1024;
+
+ChessSearch::ChessSearch(size_t const hash_megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(TableEntry) <= hash_megabytes * 1024 * 1024)
+        count *= 2;
+    table.resize(count);
+    table_mask = count - 1;
+    clear();
+}
+
+void ChessSearch::clear() {
+    TableEntry empty = {0, {0, 0}, 0, -1, exact};
+    fill(table.begin(), table.end(), empty);
+    for (int i=0; i<MAX_PLY; i++) {
+        killers[i][0] = {0, 0};
+        killers[i][1] = {0, 0};
+    }
+    pawns.clear();
+}
+
+PawnTable const &ChessSearch::pawn_table() const {
+    return pawns;
+}
+
+void ChessSearch::set_game_history(vector<uint64_t> const &keys) {
+    game_keys = keys;
+}
+
+bool ChessSearch::should_stop() {
+    if (aborted)
+        return true;
+    if (stop_flag->load(memory_order_relaxed))
+        aborted = true;
+    else if ((node_limit > 0) && (nodes >= uint64_t(node_limit)))
+        aborted = true;
+    else if (has_deadline && ((nodes % TIME_CHECK_INTERVAL) == 0) && (chrono::steady_clock::now() >= deadline))
+        aborted = true;
+    return aborted;
+}
+
+bool ChessSearch::is_repetition(int const ply) const {
+    uint64_t key = path_keys[ply];
+    /* Only positions with the same team to move can repeat, so look back 2 plies at a time. */
+    for (int i=ply-2; i>=0; i-=2) {
+        if (path_keys[i] == key)
+            return true;
+    }
+    int first = (ply % 2 == 0) ? 2 : 1;
+    for (int i=int(game_keys.size())-first; i>=0; i-=2) {
+        if (game_keys[i] == key)
+            return true;
+    }
+    return false;
+}
+
+void ChessSearch::order_moves(ChessBoard const &board, ChessMove *moves, int const count, ChessMove const &first, int const ply) const {
+    int scores[MAX_MOVES];
+    for (int i=0; i<count; i++) {
+        int victim = board.piece_at(moves[i].to);
+        if (moves[i] == first)
+            scores[i] = 1000000;
+        else if (victim >= 0)
+            scores[i] = 100000 + ORDER_VALUES[victim & 7] * 10 - ORDER_VALUES[board.piece_at(moves[i].from) & 7] / 10;
+        else if (moves[i] == killers[ply][0])
+            scores[i] = 90000;
+        else if (moves[i] == killers[ply][1])
+            scores[i] = 80000;
+        else
+            scores[i] = 0;
+    }
+    /* Insertion sort: move lists are short. */
+    for (int i=1; i<count; i++) {
+        ChessMove move = moves[i];
+        int score = scores[i];
+        int j = i - 1;
+        while ((j >= 0) && (scores[j] < score)) {
+            moves[j+1] = moves[j];
+            scores[j+1] = scores[j];
+            j--;
+        }
+        moves[j+1] = move;
+        scores[j+1] = score;
+    }
+}
+
+int ChessSearch::quiescence(ChessBoard &board, int alpha, int const beta, int const ply) {
+    nodes++;
+    pv_length[ply] = 0;
+    if (should_stop())
+        return 0;
+
+    ChessMove moves[MAX_MOVES];
+    int count = board.legal_moves(moves);
+    if (count == 0)
+        return board.in_check() ? -MATE_SCORE + ply : 0;
+
+    /* Standing pat: the team to move does not have to capture. */
+    int stand_pat = board.evaluate(&pawns);
+    if ((stand_pat >= beta) || (ply >= MAX_PLY - 1))
+        return stand_pat;
+    if (stand_pat > alpha)
+        alpha = stand_pat;
+
+    order_moves(board, moves, count, ChessMove{0, 0}, ply);
+    for (int i=0; i<count; i++) {
+        if (board.piece_at(moves[i].to) < 0)
+            break;
+        /* Skip captures that lose material in the exchange. */
+        if (board.see(moves[i].from, moves[i].to) < 0)
+            continue;
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        int score = -quiescence(board, -beta, -alpha, ply + 1);
+        board.unmake(moves[i], undo);
+        if (aborted)
+            return 0;
+        if (score >= beta)
+            return score;
+        if (score > alpha)
+            alpha = score;
+    }
+    return alpha;
+}
+
+int ChessSearch::negamax(ChessBoard &board, int depth, int alpha, int const beta, int const ply) {
+    pv_length[ply] = 0;
+    path_keys[ply] = board.position_key();
+    if ((ply > 0) && is_repetition(ply))
+        return 0;
+
+    bool check = board.in_check();
+    /* Look one ply further when in check, so mates are not hidden behind the horizon. */
+    if (check)
+        depth++;
+    if ((depth <= 0) || (ply >= MAX_PLY - 1))
+        return quiescence(board, alpha, beta, ply);
+
+    nodes++;
+    if (should_stop())
+        return 0;
+
+    /* Use the transposition table for a cut-off and for the first move to try. */
+    uint64_t key = path_keys[ply];
+    TableEntry &entry = table[key & table_mask];
+    ChessMove first = {0, 0};
+    if (entry.key == key) {
+        first = entry.move;
+        if ((ply > 0) && (entry.depth >= depth)) {
+            int score = entry.score;
+            /* Mate scores are stored relative to the position, so convert them back to this ply. */
+            if (score >= MATE_BOUND)
+                score -= ply;
+            else if (score <= -MATE_BOUND)
+                score += ply;
+            if ((entry.bound == exact) || ((entry.bound == lower) && (score >= beta)) || ((entry.bound == upper) && (score <= alpha)))
+                return score;
+        }
+    }
+
+    ChessMove moves[MAX_MOVES];
+    int count = board.legal_moves(moves);
+    if (count == 0)
+        return check ? -MATE_SCORE + ply : 0;
+    order_moves(board, moves, count, first, ply);
+
+    int original_alpha = alpha;
+    int best_score = -MATE_SCORE;
+    ChessMove best_move = moves[0];
+    for (int i=0; i<count; i++) {
+        bool capture = board.piece_at(moves[i].to) >= 0;
+        ChessMoveUndo undo;
+        board.make(moves[i], undo);
+        int score = -negamax(board, depth - 1, -beta, -alpha, ply + 1);
+        board.unmake(moves[i], undo);
+        if (aborted)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = moves[i];
+            if (score > alpha) {
+                alpha = score;
+                pv_table[ply][0] = moves[i];
+                for (int j=0; j<pv_length[ply+1]; j++)
+                    pv_table[ply][j+1] = pv_table[ply+1][j];
+                pv_length[ply] = pv_length[ply+1] + 1;
+            }
+        }
+        if (alpha >= beta) {
+            if (!capture && !(moves[i] == killers[ply][0])) {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = moves[i];
+            }
+            break;
+        }
+    }
+
+    int stored = best_score;
+    if (stored >= MATE_BOUND)
+        stored += ply;
+    else if (stored <= -MATE_BOUND)
+        stored -= ply;
+    entry.key = key;
+    entry.move = best_move;
+    entry.score = stored;
+    entry.depth = depth;
+    entry.bound = (best_score >= beta) ? lower : ((best_score > original_alpha) ? exact : upper);
+    return best_score;
+}
+
+SearchInfo ChessSearch::search(ChessBoard &board, SearchLimits const &limits, atomic<bool> &stop, InfoCallback on_iteration) {
+    auto start = chrono::steady_clock::now();
+    stop_flag = &stop;
+    has_deadline = limits.movetime > 0;
+    deadline = start + chrono::milliseconds(limits.movetime);
+    node_limit = limits.nodes;
+    nodes = 0;
+    aborted = false;
+
+    SearchInfo result;
+    result.depth = 0;
+    result.score = 0;
+    result.nodes = 0;
+    result.seconds = 0;
+    result.pv_length = 0;
+
+    /* Without a legal move there is nothing to search. */
+    ChessMove moves[MAX_MOVES];
+    int count = board.legal_moves(moves);
+    if (count == 0) {
+        result.score = board.in_check() ? -MATE_SCORE : 0;
+        return result;
+    }
+    /* Always have a move to play, even if stopped during the first iteration. */
+    result.pv[0] = moves[0];
+    result.pv_length = 1;
+
+    int max_depth = (limits.depth > 0) ? min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+    for (int depth=1; depth<=max_depth; depth++) {
+        int score = negamax(board, depth, -MATE_SCORE, MATE_SCORE, 0);
+        if (aborted && (depth > 1))
+            break;
+
+        result.depth = depth;
+        result.score = score;
+        result.nodes = nodes;
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (pv_length[0] > 0) {
+            result.pv_length = pv_length[0];
+            for (int i=0; i<pv_length[0]; i++)
+                result.pv[i] = pv_table[0][i];
+        }
+        if (on_iteration)
+            on_iteration(result);
+
+        /* Stop deepening once a forced mate is found or the search was stopped. */
+        if (aborted || (abs(score) >= MATE_BOUND))
+            break;
+    }
+    result.nodes = nodes;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
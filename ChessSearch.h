@@ -0,0 +1,116 @@
+#ifndef CHESSSEARCH_H
+#define CHESSSEARCH_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Scores at or beyond MATE_BOUND are mates: MATE_SCORE - n means the team to move mates in n plies. */
+const int MATE_SCORE = 30000;
+const int MATE_BOUND = MATE_SCORE - 1000;
+
+/* Deepest ply the search can reach (including quiescence). */
+const int MAX_PLY = 128;
+
+/* Limits of one search; a value of 0 means no limit. */
+struct SearchLimits {
+    int depth;
+    long long nodes;
+    long movetime;
+};
+
+/* Result of a search, also passed to the progress callback after every completed iteration. */
+struct SearchInfo {
+    int depth;
+    int score;
+    uint64_t nodes;
+    double seconds;
+    ChessMove pv[MAX_PLY];
+    int pv_length;
+};
+
+/* Iterative deepening alpha-beta search over the board's legal moves, with a quiescence search of captures, a transposition table and repetition detection. Positions are scored by ChessBoard::evaluate(). The search can be stopped at any time from another thread through the stop flag, which is checked at every node. */
+class ChessSearch {
+    public:
+        typedef function<void(SearchInfo const &)> InfoCallback;
+
+    private:
+        /* Bounds of the scores stored in the transposition table. */
+        enum bounds {exact, lower, upper};
+
+        struct TableEntry {
+            uint64_t key;
+            ChessMove move;
+            int16_t score;
+            int8_t depth;
+            uint8_t bound;
+        };
+
+        vector<TableEntry> table;
+        size_t table_mask;
+
+        /* Pawn structure scores of the positions evaluated. */
+        PawnTable pawns;
+
+        /* Quiet moves that caused a cut-off at each ply, tried right after the captures. */
+        ChessMove killers[MAX_PLY][2];
+
+        /* Keys of the positions played before the search (for repetitions) and of the positions on the current search path. */
+        vector<uint64_t> game_keys;
+        uint64_t path_keys[MAX_PLY + 1];
+
+        /* Principal variation collected at each ply. */
+        ChessMove pv_table[MAX_PLY][MAX_PLY];
+        int pv_length[MAX_PLY];
+
+        /* Stop conditions of the current search. */
+        atomic<bool> *stop_flag;
+        chrono::steady_clock::time_point deadline;
+        bool has_deadline;
+        long long node_limit;
+        uint64_t nodes;
+        bool aborted;
+
+        /* Function that returns true (and remembers it) once the search has to stop. */
+        bool should_stop();
+
+        /* Function that returns true if the position at the given ply repeats an earlier position. */
+        bool is_repetition(int const ply) const;
+
+        /* Function that orders moves: transposition table move, captures (most valuable victim first), killer moves, then the rest. */
+        void order_moves(ChessBoard const &board, ChessMove *moves, int const count, ChessMove const &first, int const ply) const;
+
+        /* Alpha-beta search of depth plies, returning the score for the team to move. */
+        int negamax(ChessBoard &board, int depth, int alpha, int const beta, int const ply);
+
+        /* Search of captures only, until the position is quiet. */
+        int quiescence(ChessBoard &board, int alpha, int const beta, int const ply);
+
+    public:
+        /* Constructor that allocates the transposition table.
+        @param hash_megabytes: size of the transposition table. */
+        explicit ChessSearch(size_t const hash_megabytes = 16);
+
+        /* Method that clears the transposition table, pawn table and killer moves (e.g. for a new game). */
+        void clear();
+
+        /* @return the pawn table of the search, e.g. for its hit rate. */
+        PawnTable const &pawn_table() const;
+
+        /* Method that sets the keys of the positions of the game so far (oldest first, excluding the current one), so the search scores repetitions as draws. */
+        void set_game_history(vector<uint64_t> const &keys);
+
+        /* Method that searches the board's position.
+        @param board: the position to search (back to its original state on return).
+        @param limits: depth, node and time limits.
+        @param stop: flag that stops the search as soon as another thread sets it.
+        @param on_iteration: called after every completed iteration (may be empty).
+        @return the result of the deepest completed iteration (pv_length is 0 if the team to move has no legal move). */
+        SearchInfo search(ChessBoard &board, SearchLimits const &limits, atomic<bool> &stop, InfoCallback on_iteration);
+};
+
+#endif
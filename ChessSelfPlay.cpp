@@ -0,0 +1,176 @@
+#include "ChessBoard.h"
+#include "ChessGameFile.h"
+#include "ChessThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+/* Self-play game generator: plays games of random legal moves with the board's own rules and writes them in the corpus format of ChessGameFile.h.
+Usage: selfplay <games> [-o file] [-s seed] [-t threads] [-p max plies] [--weighted]
+Every game is played from its own seed (derived from the base seed and the game number), so the output file is identical for a given seed whatever the number of threads. Each thread runs an independent generator on its own board; finished blocks of games are written in game order. --weighted prefers captures that do not lose material over other moves instead of picking uniformly. */
+
+/* Number of games a thread plays before handing them to the writer. */
+static const long GAMES_PER_BLOCK = 64;
+
+/* Random numbers of one game, from the splitmix64 generator (see ChessPosition.h). */
+struct GameRandom {
+    uint64_t state;
+
+    uint64_t next() {
+        return splitmix64(state);
+    }
+
+    /* Return a number from 0 to bound - 1. */
+    uint32_t below(uint32_t const bound) {
+        return uint32_t(((next() >> 32) * bound) >> 32);
+    }
+};
+
+struct SelfPlaySettings {
+    long games;
+    uint64_t seed;
+    int max_plies;
+    bool weighted;
+};
+
+/* Function that plays one game from the starting position.
+@param board: the board to play on (reset to the starting position first).
+@param random: the generator of the game.
+@param moves: filled with the moves played (at least max_plies entries).
+@return the number of moves played, with the result in result. */
+static int play_game(ChessBoard &board, GameRandom &random, SelfPlaySettings const &settings, ChessMove *moves, GameResult &result) {
+    static const PackedPosition start = PackedPosition::starting_position();
+    board.unpack(start);
+
+    int plies = 0;
+    ChessMove legal[MAX_MOVES];
+    int weights[MAX_MOVES];
+    while (plies < settings.max_plies) {
+        int count = board.legal_moves(legal);
+        if (count == 0) {
+            /* Checkmate or stalemate, following the board's rules for the end of the game. */
+            if (board.in_check())
+                result = board.white_to_move() ? black_wins : white_wins;
+            else
+                result = draw;
+            return plies;
+        }
+
+        int choice;
+        if (settings.weighted) {
+            /* Captures that do not lose material are 8 times as likely as other moves. */
+            int total = 0;
+            for (int i=0; i<count; i++) {
+                weights[i] = ((board.piece_at(legal[i].to) >= 0) && (board.see(legal[i].from, legal[i].to) >= 0)) ? 8 : 1;
+                total += weights[i];
+            }
+            int pick = random.below(total);
+            choice = 0;
+            while (pick >= weights[choice])
+                pick -= weights[choice++];
+        }
+        else
+            choice = random.below(count);
+
+        moves[plies++] = legal[choice];
+        board.play(legal[choice]);
+    }
+    result = unfinished;
+    return plies;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "Usage: selfplay <games> [-o file] [-s seed] [-t threads] [-p max plies] [--weighted]" << endl;
+        return 1;
+    }
+    SelfPlaySettings settings = {atol(argv[1]), 1, 300, false};
+    int threads = ChessThreadPool::hardware_threads();
+    const char *path = "selfplay.txt";
+    for (int i=2; i<argc; i++) {
+        if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+            path = argv[++i];
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            settings.seed = strtoull(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+            settings.max_plies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--weighted") == 0)
+            settings.weighted = true;
+        else {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if ((settings.games < 1) || (settings.max_plies < 1)) {
+        cerr << "The number of games and the maximum number of plies must be positive" << endl;
+        return 1;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        cerr << "Cannot open " << path << endl;
+        return 1;
+    }
+
+    ChessThreadPool pool(threads);
+    long block_count = (settings.games + GAMES_PER_BLOCK - 1) / GAMES_PER_BLOCK;
+    atomic<long> next_block(0);
+    atomic<uint64_t> total_plies(0);
+
+    /* Finished blocks wait in blocks until every earlier block has been written. */
+    vector<string> blocks(block_count);
+    vector<bool> finished(block_count, false);
+    long next_to_write = 0;
+    bool written = true;
+    mutex write_lock;
+
+    auto begin = chrono::steady_clock::now();
+    for (int t=0; t<pool.size(); t++) {
+        pool.submit([&](int) {
+            ChessBoard board(PackedPosition::starting_position());
+            vector<ChessMove> moves(settings.max_plies);
+            uint64_t plies = 0;
+            long block;
+            while ((block = next_block++) < block_count) {
+                string text;
+                long last = min(settings.games, (block + 1) * GAMES_PER_BLOCK);
+                for (long game=block*GAMES_PER_BLOCK; game<last; game++) {
+                    GameRandom random = {settings.seed * 0x2545F4914F6CDD1DULL + game};
+                    random.next();
+                    GameResult result;
+                    int count = play_game(board, random, settings, moves.data(), result);
+                    append_game(text, moves.data(), count, result);
+                    plies += count;
+                }
+
+                lock_guard<mutex> guard(write_lock);
+                blocks[block] = move(text);
+                finished[block] = true;
+                while ((next_to_write < block_count) && finished[next_to_write]) {
+                    written = written && (fwrite(blocks[next_to_write].data(), 1, blocks[next_to_write].size(), file) == blocks[next_to_write].size());
+                    string().swap(blocks[next_to_write]);
+                    next_to_write++;
+                }
+            }
+            total_plies += plies;
+        });
+    }
+    pool.wait();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    written = (fclose(file) == 0) && written;
+    if (!written) {
+        cerr << "Cannot write " << path << endl;
+        return 1;
+    }
+
+    printf("%ld games, %llu plies with %d thread(s) in %.3f s: %.0f games/s, %.0f plies/s\n", settings.games, (unsigned long long)total_plies.load(), pool.size(), seconds, settings.games / seconds, total_plies.load() / seconds);
+    return 0;
+}
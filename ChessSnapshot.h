@@ -0,0 +1,63 @@
+#ifndef CHESSSNAPSHOT_H
+#define CHESSSNAPSHOT_H
+#include <atomic>
+#include <cstdint>
+#include "ChessPosition.h"
+
+using namespace std;
+
+/* Immutable copy of a board's position as last published. */
+struct BoardSnapshot {
+    PackedPosition position;
+    /* Number of the snapshot (1 for the first one published, then one more for every snapshot published). */
+    uint64_t version;
+    bool game_over;
+};
+
+/* Single-writer, many-reader publication of BoardSnapshot values with a sequence lock. The writer never waits for readers: it makes the sequence odd, stores the words and makes it even again. Readers never block the writer either: they copy the words and retry if the sequence was odd or changed while they were copying, so they only ever return a snapshot exactly as it was published.
+The words are atomics stored with release and loaded with acquire ordering (plain moves on x86), so concurrent copying is not a data race: a reader that sees any word of a newer snapshot also sees the odd sequence stored before it, and retries. */
+class SnapshotPublisher {
+    private:
+        static const int WORDS = 5;
+
+        atomic<uint64_t> sequence;
+        atomic<uint64_t> words[WORDS];
+
+    public:
+        SnapshotPublisher() : sequence(0) {
+            for (int i=0; i<WORDS; i++)
+                words[i].store(0, memory_order_relaxed);
+        }
+
+        SnapshotPublisher(SnapshotPublisher const &) = delete;
+        SnapshotPublisher &operator=(SnapshotPublisher const &) = delete;
+
+        /* Method that publishes a new snapshot. Must only be called by one thread at a time (the board's writer). */
+        void publish(PackedPosition const &position, bool const game_over) {
+            uint64_t start = sequence.load(memory_order_relaxed);
+            sequence.store(start + 1, memory_order_relaxed);
+            for (int i=0; i<4; i++)
+                words[i].store(position.words[i], memory_order_release);
+            words[4].store(game_over ? 1 : 0, memory_order_release);
+            sequence.store(start + 2, memory_order_release);
+        }
+
+        /* Method that returns the last published snapshot. May be called from any number of threads while the writer publishes. */
+        BoardSnapshot read() const {
+            BoardSnapshot snapshot;
+            while (true) {
+                uint64_t before = sequence.load(memory_order_acquire);
+                if (before & 1)
+                    continue;
+                for (int i=0; i<4; i++)
+                    snapshot.position.words[i] = words[i].load(memory_order_acquire);
+                snapshot.game_over = words[4].load(memory_order_acquire) != 0;
+                if (sequence.load(memory_order_relaxed) == before) {
+                    snapshot.version = before / 2;
+                    return snapshot;
+                }
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "ChessBoard.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+/* Concurrency stress test of the board: plays many independent boards through full games at the same time.
+Usage: stress [-b boards] [-t max threads] [-p max plies] [-s seed]
+Every board plays a game of random legal moves submitted with submitMove(), writing its messages to its own stream, and runs the const queries (legal_moves(), game_status(), see(), evaluate()) on every position. The games are played with 1 thread, then 2, 4, ... up to the maximum: the results of every board must be identical whatever the number of threads, and the throughput of each run is reported with its speedup over 1 thread. Build with "make stress_tsan" to run it under ThreadSanitizer. */
+
+struct BoardResult {
+    int plies;
+    uint64_t key;
+    size_t message_bytes;
+    long query_sum;
+    bool consistent;
+};
+
+static void usage() {
+    cerr << "Usage: stress [-b boards] [-t max threads] [-p max plies] [-s seed]" << endl;
+}
+
+/* Function that plays the game of one board and records what it ended with. The moves are picked with splitmix64() from the seed, so every board plays the same game on every run. */
+static BoardResult play_board(uint64_t seed, int const max_plies) {
+    BoardResult result = {0, 0, 0, 0, true};
+    ChessBoard board(PackedPosition::starting_position());
+    ostringstream messages;
+    board.set_output(&messages, &messages);
+
+    ChessMove legal[MAX_MOVES];
+    while (result.plies < max_plies) {
+        int count = board.legal_moves(legal);
+        GameStatus status = board.game_status();
+        if (count == 0) {
+            result.consistent = result.consistent && ((status == game_checkmate) || (status == game_stalemate));
+            break;
+        }
+        ChessMove move = legal[splitmix64(seed) % count];
+        result.query_sum += status + board.see(move.from, move.to) + board.evaluate();
+
+        char from[3], to[3];
+        square_name(move.from, from);
+        square_name(move.to, to);
+        board.submitMove(from, to);
+        result.plies++;
+        /* The move must have been accepted, and published. */
+        result.consistent = result.consistent && (board.white_to_move() == (result.plies % 2 == 0)) && (board.read_snapshot().position.key() == board.position_key());
+    }
+    result.key = board.position_key();
+    result.message_bytes = messages.str().size();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int boards = 64, max_threads = ChessThreadPool::hardware_threads(), max_plies = 200;
+    uint64_t seed = 1;
+    for (int i=1; i<argc; i++) {
+        if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+            boards = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            max_threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+            max_plies = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            seed = strtoull(argv[++i], NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if ((boards < 1) || (max_threads < 1)) {
+        usage();
+        return 1;
+    }
+
+    vector<BoardResult> expected;
+    double single_rate = 0;
+    bool failed = false;
+    for (int threads=1; ; threads=min(threads * 2, max_threads)) {
+        vector<BoardResult> results(boards);
+        auto begin = chrono::steady_clock::now();
+        {
+            ChessThreadPool pool(threads);
+            for (int b=0; b<boards; b++)
+                pool.submit([&, b](int) { results[b] = play_board(seed * 1000003 + b, max_plies); });
+            pool.wait();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        long plies = 0;
+        int mismatches = 0;
+        for (int b=0; b<boards; b++) {
+            BoardResult const &result = results[b];
+            plies += result.plies;
+            bool same = expected.empty() || ((result.plies == expected[b].plies) && (result.key == expected[b].key) && (result.message_bytes == expected[b].message_bytes) && (result.query_sum == expected[b].query_sum));
+            if (!result.consistent || !same)
+                mismatches++;
+        }
+        if (expected.empty()) {
+            expected = results;
+            single_rate = plies / seconds;
+        }
+        printf("%2d thread(s): %d boards, %ld plies in %.3f s (%.0f plies/s, speedup %.2f), %d board(s) inconsistent\n", threads, boards, plies, seconds, plies / seconds, plies / seconds / single_rate, mismatches);
+        failed = failed || (mismatches > 0);
+        if (threads >= max_threads)
+            break;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include <cstdlib>
+#include "ChessTables.h"
+#include "ChessBitboard.h"
+
+/* {rank step, file step} of each SquareTables::ray_directions direction. */
+static constexpr int DIRECTION_STEPS[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+/* {rank step, file step} of the 8 knight jumps. */
+static constexpr int KNIGHT_STEPS[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+
+static constexpr bool on_board(int const rank, int const file) {
+    return (rank >= 0) && (rank < 8) && (file >= 0) && (file < 8);
+}
+
+static constexpr SquareTables make_square_tables() {
+    SquareTables tables = {};
+    for (int from=0; from<64; from++) {
+        for (int to=0; to<64; to++)
+            tables.direction[from][to] = SquareTables::no_direction;
+    }
+
+    for (int square=0; square<64; square++) {
+        int rank = square / 8, file = square % 8;
+
+        /* Walk each direction to the edge, recording the ray, the direction and the squares passed on the way to every square reached. */
+        for (int d=0; d<8; d++) {
+            uint64_t path = 0;
+            int i = rank + DIRECTION_STEPS[d][0], j = file + DIRECTION_STEPS[d][1];
+            while (on_board(i, j)) {
+                int target = i * 8 + j;
+                tables.direction[square][target] = d;
+                tables.between[square][target] = path;
+                path |= 1ULL << target;
+                i += DIRECTION_STEPS[d][0];
+                j += DIRECTION_STEPS[d][1];
+            }
+            tables.rays[square][d] = path;
+
+            /* The king moves one step in any direction. */
+            if (on_board(rank + DIRECTION_STEPS[d][0], file + DIRECTION_STEPS[d][1]))
+                tables.king[square] |= 1ULL << ((rank + DIRECTION_STEPS[d][0]) * 8 + file + DIRECTION_STEPS[d][1]);
+        }
+
+        for (int k=0; k<8; k++) {
+            if (on_board(rank + KNIGHT_STEPS[k][0], file + KNIGHT_STEPS[k][1]))
+                tables.knight[square] |= 1ULL << ((rank + KNIGHT_STEPS[k][0]) * 8 + file + KNIGHT_STEPS[k][1]);
+        }
+
+        /* Pawns attack the diagonal squares one rank ahead: up the board for white, down for black. */
+        for (int team=0; team<2; team++) {
+            int ahead = (team == 0) ? rank + 1 : rank - 1;
+            for (int side=-1; side<=1; side+=2) {
+                if (on_board(ahead, file + side))
+                    tables.pawn_attacks[team][square] |= 1ULL << (ahead * 8 + file + side);
+            }
+        }
+    }
+    return tables;
+}
+
+extern constexpr SquareTables SQUARE_TABLES = make_square_tables();
+
+/* Magic numbers of the rook and bishop squares, found by a search for multipliers mapping every relevant occupancy of the square to an index (in the top popcount(mask) bits of the product) without two occupancies with different attack sets colliding. */
+static const uint64_t ROOK_MAGICS[64] = {
+    0x8080048820104000ULL, 0x0040004020001001ULL, 0x8200104200208009ULL, 0x1100201001000805ULL,
+    0x0100041003000800ULL, 0x0900080400210002ULL, 0x8400108409221008ULL, 0x020000442C010882ULL,
+    0x6420800020804001ULL, 0x0022002040810208ULL, 0x0202801000802000ULL, 0x0001000825001000ULL,
+    0x0005000800047100ULL, 0x0240800200800401ULL, 0x0005000402000900ULL, 0x0020800080006100ULL,
+    0x1480004000200041ULL, 0x0440004020100044ULL, 0x004084801004A000ULL, 0x20B10A0010402200ULL,
+    0x0027808004008800ULL, 0x0802008080040002ULL, 0x5080040090010208ULL, 0x34A0220000408114ULL,
+    0x20C0002080004090ULL, 0x4800400100208100ULL, 0x0010208200420010ULL, 0x0021000900211000ULL,
+    0x0001001100080104ULL, 0x0118020080040080ULL, 0x1030420400100148ULL, 0x800800420000AC01ULL,
+    0x108000200C400641ULL, 0x0080400081002100ULL, 0xC000100484802000ULL, 0x8420080080801001ULL,
+    0x5302100801000500ULL, 0x1011000401000802ULL, 0x2010321004000118ULL, 0x002021084200008CULL,
+    0x0880002000404000ULL, 0x0000201004434001ULL, 0x0000110020010042ULL, 0x0040210050030028ULL,
+    0x2018040008008080ULL, 0x0204010002004040ULL, 0x04A0010002008080ULL, 0x0083000080410002ULL,
+    0x008F218102004200ULL, 0x0000401002200440ULL, 0x2000200010008280ULL, 0x0801080010008480ULL,
+    0x100C000800802480ULL, 0x8008800400020080ULL, 0x0000427108100400ULL, 0x100001188C004200ULL,
+    0x1000800100102049ULL, 0x2002050020104882ULL, 0x0000110208200041ULL, 0x0010041000200901ULL,
+    0x0003000800029005ULL, 0x1021000204000801ULL, 0x1020900088020104ULL, 0x03010C2401025082ULL
+};
+
+static const uint64_t BISHOP_MAGICS[64] = {
+    0x80284820980C4100ULL, 0x04100400C08200A0ULL, 0x1608080060802480ULL, 0x01220A0604440010ULL,
+    0x0844042000200031ULL, 0x400A082405810800ULL, 0x0608414420202400ULL, 0x9000840108020200ULL,
+    0x5000110208880080ULL, 0x0000101002104040ULL, 0x000108208D020500ULL, 0x8000280A10A0C400ULL,
+    0x0408011040002004ULL, 0x00402104A0440C21ULL, 0x2180010108024004ULL, 0x4404408404020200ULL,
+    0x10043012A0024400ULL, 0x4182000524180200ULL, 0x0410007D00408104ULL, 0x040A102022004004ULL,
+    0x0010101202100040ULL, 0x8001801900A00900ULL, 0x2000404422021001ULL, 0x2005080021211005ULL,
+    0x0108400020040104ULL, 0x000804A009210800ULL, 0x8104100041024086ULL, 0x0204010020200880ULL,
+    0x0301010008104000ULL, 0x03580020A2100400ULL, 0x0807044A09080804ULL, 0x0002020002B98208ULL,
+    0x2801084800421018ULL, 0x9214100200040460ULL, 0x2422005104100300ULL, 0x1124020080080080ULL,
+    0x0200408020020200ULL, 0x0420090040820808ULL, 0x0001080280230454ULL, 0x0004144140108422ULL,
+    0x0A51042020400400ULL, 0x4092021004400240ULL, 0x4006602030111800ULL, 0x0400084208000080ULL,
+    0x0901902A10101200ULL, 0x03D0011001000420ULL, 0x3004908400400100ULL, 0x4002020204218200ULL,
+    0x2101180212603251ULL, 0x620100A801080084ULL, 0x0090118048680101ULL, 0x0040000020880080ULL,
+    0x030002A883040000ULL, 0x0001200411021000ULL, 0x600A200404144000ULL, 0x0064010404029000ULL,
+    0x0000410400A24000ULL, 0x4801008424220200ULL, 0x04C2201052009000ULL, 0x80A4000001228800ULL,
+    0x8100228130020888ULL, 0x0202100414080A08ULL, 0x0A08441002481110ULL, 0x0210500080908200ULL
+};
+
+/* Return true if PEXT is available and fast on this CPU. AMD CPUs before Zen 3 have BMI2 but run PEXT in microcode, much slower than a multiplication, so they use the magic numbers too. */
+static bool cpu_has_fast_pext() {
+    if (getenv("CHESS_NO_PEXT") != NULL)
+        return false;
+#if defined(__x86_64__) && defined(__GNUC__)
+    /* This runs before main(), so the CPU data of the builtins may not be initialised yet. */
+    __builtin_cpu_init();
+    if (__builtin_cpu_is("amdfam15h") || __builtin_cpu_is("znver1") || __builtin_cpu_is("znver2"))
+        return false;
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+SlidingAttacks::SlidingAttacks() {
+    pext = cpu_has_fast_pext();
+    uint32_t offset = 0;
+    for (int kind=0; kind<2; kind++) {
+        /* Rooks use the straight directions (the first 4), bishops the diagonal ones. */
+        Entry *entries = (kind == 0) ? rook : bishop;
+        int first_direction = (kind == 0) ? SquareTables::north : SquareTables::north_east;
+        for (int square=0; square<64; square++) {
+            Entry &entry = entries[square];
+            /* A chess piece on the last square of a ray cannot hide any square behind it, so only the squares before the edge select the attack set. */
+            entry.mask = 0;
+            for (int d=first_direction; d<first_direction+4; d++) {
+                uint64_t ray = SQUARE_TABLES.rays[square][d];
+                if (ray != 0)
+                    entry.mask |= ray ^ square_bit((ray > square_bit(square)) ? highest_square(ray) : lowest_square(ray));
+            }
+            entry.magic = (kind == 0) ? ROOK_MAGICS[square] : BISHOP_MAGICS[square];
+            entry.shift = 64 - bit_count(entry.mask);
+            entry.offset = offset;
+            offset += 1U << bit_count(entry.mask);
+
+            /* Walk every subset of the mask and store the attack set found by scanning the rays. */
+            uint64_t occupied = 0;
+            do {
+                uint64_t set = 0;
+                for (int d=first_direction; d<first_direction+4; d++)
+                    set |= ray_attacks(square, occupied, d);
+                attacks[entry.offset + sliding_index(entry, occupied, pext)] = set;
+                occupied = (occupied - entry.mask) & entry.mask;
+            } while (occupied != 0);
+        }
+    }
+}
+
+const SlidingAttacks SLIDING_ATTACKS;
@@ -0,0 +1,60 @@
+#ifndef CHESSTABLES_H
+#define CHESSTABLES_H
+#include <cstdint>
+
+using namespace std;
+
+/* Square relations precomputed at compile time, so the movement rules of the chess pieces are table lookups (and a scan of the squares in between) instead of distance arithmetic and direction chains. Squares are numbered rank * 8 + file as in PackedPosition, and square sets are bitboards. */
+struct SquareTables {
+    /* Directions along a rank, file or diagonal: the first 4 are straight (rook) directions, the last 4 diagonal (bishop) directions. no_direction marks squares that are not on a common line. */
+    enum ray_directions {north, south, east, west, north_east, north_west, south_east, south_west, no_direction};
+
+    /* rays[square][direction]: the squares from the square (excluded) to the edge of the board in the direction. */
+    uint64_t rays[64][8];
+
+    /* between[from][to]: the squares strictly between two squares on a common line, 0 if they are not on one. */
+    uint64_t between[64][64];
+
+    /* direction[from][to]: the direction (ray_directions) from one square to the other. */
+    uint8_t direction[64][64];
+
+    /* The squares a knight or king on a square moves to. */
+    uint64_t knight[64];
+    uint64_t king[64];
+
+    /* pawn_attacks[team][square]: the squares a pawn on a square attacks ([0] white, [1] black). */
+    uint64_t pawn_attacks[2][64];
+};
+
+extern const SquareTables SQUARE_TABLES;
+
+/* Total number of entries of the rook and bishop attack tables: one per relevant occupancy of every square. */
+const int SLIDING_TABLE_SIZE = 102400 + 5248;
+
+/* Attack sets of the sliding pieces for every occupancy, built once at startup so rook_attacks() and bishop_attacks() are a single table lookup. Only the occupied squares on a slider's lines that can block it (the edge squares never do) select its attack set: on CPUs with BMI2 they are gathered into the table index by the PEXT instruction, elsewhere by the magic multiplication ((occupied & mask) * magic) >> shift. Both give an index below 2 ^ popcount(mask) for each square, so the two methods share the layout of the table and only fill it differently. The method is chosen when the table is built, from the CPU features (or magic multiplication if the environment variable CHESS_NO_PEXT is set, to measure it on a BMI2 CPU), so one binary runs at full speed on both kinds of CPU. */
+struct SlidingAttacks {
+    /* Lookup data of one square for one kind of slider. */
+    struct Entry {
+        /* The squares whose occupancy selects the attack set. */
+        uint64_t mask;
+        uint64_t magic;
+        /* Position of the square's attack sets in the table. */
+        uint32_t offset;
+        uint32_t shift;
+    };
+
+    Entry rook[64];
+    Entry bishop[64];
+
+    /* True if the table is indexed with PEXT. */
+    bool pext;
+
+    uint64_t attacks[SLIDING_TABLE_SIZE];
+
+    /* Constructor that detects the CPU features and fills the table. */
+    SlidingAttacks();
+};
+
+extern const SlidingAttacks SLIDING_ATTACKS;
+
+#endif
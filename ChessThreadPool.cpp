@@ -0,0 +1,102 @@
+#include "ChessThreadPool.h"
+
+/* Index of the worker owned by the current thread (-1 outside the pool), used to send tasks submitted by a task to its own worker's queue. */
+static thread_local int current_worker = -1;
+static thread_local const ChessThreadPool *current_pool = NULL;
+
+ChessThreadPool::ChessThreadPool(int const thread_count) : pending(0), queued(0), next_queue(0), stopping(false) {
+    int count = (thread_count < 1) ? 1 : thread_count;
+    for (int i=0; i<count; i++)
+        queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+    for (int i=0; i<count; i++)
+        threads.push_back(thread(&ChessThreadPool::run, this, i));
+}
+
+ChessThreadPool::~ChessThreadPool() {
+    wait();
+    {
+        lock_guard<mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake_up.notify_all();
+    for (auto &worker : threads)
+        worker.join();
+}
+
+int ChessThreadPool::size() const {
+    return threads.size();
+}
+
+int ChessThreadPool::hardware_threads() {
+    unsigned count = thread::hardware_concurrency();
+    return (count == 0) ? 1 : count;
+}
+
+void ChessThreadPool::submit(Task task) {
+    /* Keep tasks created by a worker on its own queue, spread the others round robin. */
+    int queue = ((current_pool == this) && (current_worker >= 0)) ? current_worker : next_queue++ % queues.size();
+    pending++;
+    {
+        lock_guard<mutex> guard(queues[queue]->lock);
+        queues[queue]->tasks.push_back(move(task));
+    }
+    /* Counting the task under sleep_lock makes sure a worker about to sleep sees it. */
+    {
+        lock_guard<mutex> guard(sleep_lock);
+        queued++;
+    }
+    wake_up.notify_one();
+}
+
+bool ChessThreadPool::take_task(int const worker, Task &task) {
+    /* Own queue first, newest task first. */
+    {
+        WorkerQueue &own = *queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    /* Otherwise steal the oldest task of another worker. */
+    for (size_t i=1; i<queues.size(); i++) {
+        WorkerQueue &victim = *queues[(worker + i) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ChessThreadPool::run(int const worker) {
+    current_worker = worker;
+    current_pool = this;
+    Task task;
+    while (true) {
+        if (take_task(worker, task)) {
+            task(worker);
+            task = nullptr;
+            /* The last task to finish wakes up wait(). */
+            if (--pending == 0) {
+                lock_guard<mutex> guard(sleep_lock);
+                all_done.notify_all();
+            }
+            continue;
+        }
+        unique_lock<mutex> guard(sleep_lock);
+        wake_up.wait(guard, [this] { return (queued > 0) || stopping; });
+        if (stopping && (queued == 0))
+            return;
+    }
+}
+
+void ChessThreadPool::wait() {
+    unique_lock<mutex> guard(sleep_lock);
+    all_done.wait(guard, [this] { return pending == 0; });
+}
@@ -0,0 +1,71 @@
+#ifndef CHESSTHREADPOOL_H
+#define CHESSTHREADPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Work-stealing thread pool. Every worker has its own queue: tasks submitted from inside a task go to the submitting worker's queue and are taken newest first (depth first), while idle workers steal the oldest task of another worker (usually the biggest piece of work left). */
+class ChessThreadPool {
+    public:
+        /* A task receives the index of the worker running it (0 to size() - 1), e.g. to use that worker's own board. */
+        typedef function<void(int)> Task;
+
+    private:
+        struct WorkerQueue {
+            mutex lock;
+            deque<Task> tasks;
+        };
+
+        vector<unique_ptr<WorkerQueue>> queues;
+        vector<thread> threads;
+
+        /* Number of tasks submitted but not finished yet, number of tasks waiting in the queues, and the round robin position for tasks submitted from outside the pool. */
+        atomic<long> pending;
+        atomic<long> queued;
+        atomic<unsigned> next_queue;
+        atomic<bool> stopping;
+
+        /* Idle workers sleep on wake_up, wait() sleeps on all_done. */
+        mutex sleep_lock;
+        condition_variable wake_up;
+        condition_variable all_done;
+
+        /* Main loop of each worker thread. */
+        void run(int const worker);
+
+        /* Function that takes a task from the worker's own queue, or steals one from another worker.
+        @return true if a task was found. */
+        bool take_task(int const worker, Task &task);
+
+    public:
+        /* Constructor that starts the worker threads.
+        @param thread_count: number of workers (at least 1). */
+        explicit ChessThreadPool(int const thread_count);
+
+        /* Destructor that waits for the queued tasks and stops the workers. */
+        ~ChessThreadPool();
+
+        ChessThreadPool(ChessThreadPool const &) = delete;
+        ChessThreadPool &operator=(ChessThreadPool const &) = delete;
+
+        /* Method that queues a task. May be called from inside a task. */
+        void submit(Task task);
+
+        /* Method that blocks until every task submitted (including tasks submitted by tasks) has finished. Must not be called from inside a task. */
+        void wait();
+
+        /* @return the number of workers. */
+        int size() const;
+
+        /* @return the number of hardware threads, or 1 if unknown. */
+        static int hardware_threads();
+};
+
+#endif
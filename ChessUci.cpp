@@ -0,0 +1,291 @@
+#include "ChessBoard.h"
+#include "ChessNetwork.h"
+#include "ChessSearch.h"
+
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Universal Chess Interface front-end: reads commands from stdin and writes replies to stdout, so the engine can be run by chess GUIs and tournament managers.
+The main thread only reads and dispatches commands, the search runs on its own thread and every reply goes through a queue drained by a writer thread. This way "stop" is seen as soon as it arrives (the search checks the stop flag at every node) and a slow reader of stdout never blocks the search.
+Moves are in UCI notation ("e2e4"); the rules are those of ChessBoard (no en passant, no promotion), so a promotion suffix is ignored and moves the board does not allow are rejected. */
+
+/* Replies are never written to stdout by the thread that produces them: they are queued and written, one line at a time and flushed, by a dedicated thread. */
+class UciOutput {
+    private:
+        mutex lock;
+        condition_variable ready;
+        deque<string> lines;
+        bool closing;
+        thread writer;
+
+        void run() {
+            unique_lock<mutex> guard(lock);
+            while (true) {
+                ready.wait(guard, [this] { return !lines.empty() || closing; });
+                if (lines.empty())
+                    return;
+                string line = move(lines.front());
+                lines.pop_front();
+                guard.unlock();
+                fwrite(line.data(), 1, line.size(), stdout);
+                fputc('\n', stdout);
+                fflush(stdout);
+                guard.lock();
+            }
+        }
+
+    public:
+        UciOutput() : closing(false), writer(&UciOutput::run, this) {}
+
+        /* Write every queued line before returning. */
+        ~UciOutput() {
+            {
+                lock_guard<mutex> guard(lock);
+                closing = true;
+            }
+            ready.notify_one();
+            writer.join();
+        }
+
+        void send(string line) {
+            {
+                lock_guard<mutex> guard(lock);
+                lines.push_back(move(line));
+            }
+            ready.notify_one();
+        }
+};
+
+/* Return the UCI name of a move, e.g. "e2e4". */
+static string move_name(ChessMove const &move) {
+    char from[3], to[3];
+    square_name(move.from, from);
+    square_name(move.to, to);
+    string name = string(from) + to;
+    for (auto &c : name)
+        c = tolower(c);
+    return name;
+}
+
+/* Return the UCI score of a search score: "cp <centipawns>" or "mate <moves>" (negative when the team to move is mated). */
+static string score_name(int const score) {
+    if (score >= MATE_BOUND)
+        return "mate " + to_string((MATE_SCORE - score + 1) / 2);
+    if (score <= -MATE_BOUND)
+        return "mate -" + to_string((MATE_SCORE + score) / 2);
+    return "cp " + to_string(score);
+}
+
+/* State of the engine shared between the input thread and the search thread. */
+class UciEngine {
+    private:
+        UciOutput &output;
+        ChessNetwork network;
+        ChessSearch searcher;
+
+        /* Current position and the keys of the positions before it (for repetitions). */
+        ChessBoard board;
+        vector<uint64_t> history;
+
+        /* The search thread runs one "go" at a time; in infinite mode it holds the best move back until "stop" arrives. */
+        thread search_thread;
+        atomic<bool> stop_flag;
+        mutex stop_lock;
+        condition_variable stop_requested;
+
+        void run_search(ChessBoard position, SearchLimits const limits, bool const infinite) {
+            SearchInfo result = searcher.search(position, limits, stop_flag, [this](SearchInfo const &info) {
+                ostringstream line;
+                line << "info depth " << info.depth << " score " << score_name(info.score) << " nodes " << info.nodes
+                     << " time " << (long long)(info.seconds * 1000) << " nps " << (long long)(info.nodes / (info.seconds > 0 ? info.seconds : 1e-3));
+                if (info.pv_length > 0) {
+                    line << " pv";
+                    for (int i=0; i<info.pv_length; i++)
+                        line << ' ' << move_name(info.pv[i]);
+                }
+                output.send(line.str());
+            });
+            if (infinite) {
+                unique_lock<mutex> guard(stop_lock);
+                stop_requested.wait(guard, [this] { return stop_flag.load(); });
+            }
+            output.send("bestmove " + ((result.pv_length > 0) ? move_name(result.pv[0]) : string("0000")));
+        }
+
+        /* Stop the running search (if any) and wait for it to print its best move. */
+        void stop_search() {
+            {
+                lock_guard<mutex> guard(stop_lock);
+                stop_flag = true;
+            }
+            stop_requested.notify_all();
+            if (search_thread.joinable())
+                search_thread.join();
+        }
+
+        /* Function that handles "position [startpos | fen <fen>] [moves <move> ...]". */
+        void set_position(istringstream &input) {
+            string token, fen;
+            input >> token;
+            if (token == "startpos") {
+                fen = STARTING_FEN;
+                input >> token;
+            }
+            else if (token == "fen") {
+                while ((input >> token) && (token != "moves"))
+                    fen += token + " ";
+            }
+            else
+                return;
+
+            PackedPosition position;
+            if (!PackedPosition::from_fen(fen, position)) {
+                output.send("info string invalid fen " + fen);
+                return;
+            }
+            board.unpack(position);
+            history.clear();
+            if (token != "moves")
+                return;
+
+            while (input >> token) {
+                int from = square_from_name(token.c_str());
+                int to = (token.size() >= 4) ? square_from_name(token.c_str() + 2) : -1;
+                ChessMove moves[MAX_MOVES];
+                int count = board.legal_moves(moves), i = 0;
+                while ((i < count) && !((moves[i].from == from) && (moves[i].to == to)))
+                    i++;
+                if (i == count) {
+                    output.send("info string illegal move " + token);
+                    return;
+                }
+                history.push_back(board.position_key());
+                board.play(moves[i]);
+            }
+        }
+
+        /* Function that handles "go" with depth, nodes, movetime, wtime/btime/winc/binc/movestogo or infinite. */
+        void go(istringstream &input) {
+            SearchLimits limits = {0, 0, 0};
+            long time_left[2] = {0, 0}, increment[2] = {0, 0}, moves_to_go = 0;
+            bool infinite = false;
+            string token;
+            while (input >> token) {
+                if (token == "depth")
+                    input >> limits.depth;
+                else if (token == "nodes")
+                    input >> limits.nodes;
+                else if (token == "movetime")
+                    input >> limits.movetime;
+                else if (token == "wtime")
+                    input >> time_left[0];
+                else if (token == "btime")
+                    input >> time_left[1];
+                else if (token == "winc")
+                    input >> increment[0];
+                else if (token == "binc")
+                    input >> increment[1];
+                else if (token == "movestogo")
+                    input >> moves_to_go;
+                else if (token == "infinite")
+                    infinite = true;
+            }
+
+            /* Clock: spend an even share of the remaining time plus most of the increment, keeping a margin for the transmission delay. */
+            int team = board.white_to_move() ? 0 : 1;
+            if (!infinite && (limits.movetime == 0) && (time_left[team] > 0)) {
+                long share = time_left[team] / ((moves_to_go > 0) ? moves_to_go : 30) + increment[team] * 3 / 4;
+                long margin = time_left[team] - 50;
+                limits.movetime = max(1L, min(share, margin));
+            }
+            if (infinite)
+                limits = {0, 0, 0};
+
+            stop_search();
+            stop_flag = false;
+            ChessBoard position(board);
+            position.attach_network(network.loaded() ? &network : NULL);
+            searcher.set_game_history(history);
+            search_thread = thread(&UciEngine::run_search, this, move(position), limits, infinite);
+        }
+
+        /* Function that handles "setoption name <name> value <value>". */
+        void set_option(istringstream &input) {
+            string token, name, value;
+            input >> token;
+            while ((input >> token) && (token != "value"))
+                name += (name.empty() ? "" : " ") + token;
+            getline(input >> ws, value);
+            if (name == "EvalFile") {
+                stop_search();
+                if (network.load(value.c_str()))
+                    output.send("info string loaded network " + value);
+                else
+                    output.send("info string could not load network " + value + ", using material evaluation");
+            }
+            else if (name == "Hash") {
+                stop_search();
+                searcher = ChessSearch(max(1L, atol(value.c_str())));
+            }
+        }
+
+    public:
+        explicit UciEngine(UciOutput &uci_output) : output(uci_output), board(PackedPosition::starting_position()), stop_flag(false) {}
+
+        ~UciEngine() {
+            stop_search();
+        }
+
+        /* Function that handles one line of input.
+        @return false once "quit" is received. */
+        bool command(string const &line) {
+            istringstream input(line);
+            string token;
+            input >> token;
+            if (token == "uci") {
+                output.send("id name ChessGame");
+                output.send("id author liangsiwei1994");
+                output.send("option name Hash type spin default 16 min 1 max 4096");
+                output.send("option name EvalFile type string default <empty>");
+                output.send("uciok");
+            }
+            else if (token == "isready")
+                output.send("readyok");
+            else if (token == "ucinewgame") {
+                stop_search();
+                searcher.clear();
+            }
+            else if (token == "position") {
+                stop_search();
+                set_position(input);
+            }
+            else if (token == "go")
+                go(input);
+            else if (token == "stop")
+                stop_search();
+            else if (token == "setoption")
+                set_option(input);
+            else if (token == "quit")
+                return false;
+            return true;
+        }
+};
+
+int main() {
+    UciOutput output;
+    UciEngine engine(output);
+    string line;
+    while (getline(cin, line) && engine.command(line)) {}
+    return 0;
+}
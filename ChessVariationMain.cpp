@@ -0,0 +1,78 @@
+#include "ChessBoard.h"
+#include "ChessVariationTree.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/* Variation tree benchmark: simulates an analysis session exploring random branches from the starting position.
+Usage: variations [-n nodes] [-d max depth] [-s seed]
+Until the tree holds the given number of positions, the session either plays a random legal move from the current node, switches to a nearby branch (taking back up to 8 moves and entering an explored move), or now and then jumps to a random node of the tree (always at the maximum depth). It reports the positions merged by transposition, the fixed memory of the tree, and how many moves the board made per branch switch and per jump compared with replaying the line from the root. */
+
+static void usage() {
+    cerr << "Usage: variations [-n nodes] [-d max depth] [-s seed]" << endl;
+}
+
+int main(int argc, char **argv) {
+    size_t target = 1000000;
+    size_t max_depth = 24;
+    uint64_t seed = 1;
+    for (int i=1; i<argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            target = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+            max_depth = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            seed = strtoull(argv[++i], NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    auto begin = chrono::steady_clock::now();
+    VariationTree tree(PackedPosition::starting_position(), target);
+    /* Index 0 counts the switches to a nearby branch, index 1 the jumps to any node. */
+    uint64_t switches[2] = {0, 0}, switch_moves[2] = {0, 0}, replay_moves[2] = {0, 0}, plays = 0;
+    ChessMove legal[MAX_MOVES], explored[MAX_MOVES];
+    uint32_t children[MAX_MOVES];
+    while (tree.node_count() < target) {
+        int count = tree.position().legal_moves(legal);
+        uint64_t choice = splitmix64(seed);
+        if ((count == 0) || (tree.current_line().size() >= max_depth) || (choice % 4 == 0)) {
+            /* Move to another branch: either take back a few moves and enter an explored sibling line, or jump anywhere. Count the moves the board made and took back, against replaying the line of the new node from the root. */
+            int kind = (choice % 16 == 0) ? 1 : 0;
+            uint64_t before = tree.board_move_count();
+            if (kind == 0) {
+                for (uint64_t up=1+splitmix64(seed)%8; (up>0) && tree.back(); up--);
+                int explored_count = tree.children(tree.current(), explored, children);
+                if (explored_count > 0)
+                    tree.play(explored[splitmix64(seed) % explored_count]);
+            }
+            else
+                tree.go_to(splitmix64(seed) % tree.node_count());
+            switch_moves[kind] += tree.board_move_count() - before;
+            replay_moves[kind] += tree.current_line().size();
+            switches[kind]++;
+            continue;
+        }
+        if (!tree.play(legal[splitmix64(seed) % count]))
+            break;
+        plays++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    size_t nodes = tree.node_count(), edges = tree.edge_count();
+    printf("%zu positions, %zu explored moves (%zu reaching a position already in the tree), %.1f MB allocated (%.1f bytes per position)\n", nodes, edges, edges - (nodes - 1), tree.memory_bytes() / 1048576.0, double(tree.memory_bytes()) / nodes);
+    printf("%llu moves played, %llu branch switches and %llu jumps in %.3f s\n", (unsigned long long)plays, (unsigned long long)switches[0], (unsigned long long)switches[1], seconds);
+    static const char *const KIND_NAMES[2] = {"branch switch", "jump"};
+    for (int kind=0; kind<2; kind++) {
+        if (switches[kind] > 0)
+            printf("%.2f board moves per %s instead of %.2f replayed from the root\n", double(switch_moves[kind]) / switches[kind], KIND_NAMES[kind], double(replay_moves[kind]) / switches[kind]);
+    }
+    return 0;
+}
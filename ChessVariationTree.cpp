@@ -0,0 +1,157 @@
+#include <algorithm>
+#include "ChessVariationTree.h"
+
+VariationTree::VariationTree(PackedPosition const &root, size_t const node_capacity) : max_nodes(max<size_t>(node_capacity, 1)), max_edges(2 * max<size_t>(node_capacity, 1)), board(root), board_moves(0) {
+    nodes.reserve(max_nodes);
+    edges.reserve(max_edges);
+    size_t table_size = 2;
+    while (table_size < 2 * max_nodes)
+        table_size *= 2;
+    table.assign(table_size, NO_NODE);
+    table_mask = table_size - 1;
+
+    Node root_node = {board.position_key(), NO_NODE, {0, 0}, NO_NODE};
+    nodes.push_back(root_node);
+    table[find_slot(root_node.key)] = 0;
+    line_nodes.push_back(0);
+}
+
+VariationTree::~VariationTree() {
+    while (back());
+}
+
+size_t VariationTree::find_slot(uint64_t const key) const {
+    size_t slot = key & table_mask;
+    while ((table[slot] != NO_NODE) && (nodes[table[slot]].key != key))
+        slot = (slot + 1) & table_mask;
+    return slot;
+}
+
+uint32_t VariationTree::find_edge(uint32_t const node, ChessMove const &move) const {
+    for (uint32_t edge=nodes[node].first_edge; edge!=NO_NODE; edge=edges[edge].next) {
+        if (edges[edge].move == move)
+            return edge;
+    }
+    return NO_NODE;
+}
+
+bool VariationTree::play(ChessMove const &move) {
+    uint32_t node = line_nodes.back();
+    uint32_t edge = find_edge(node, move);
+    /* A move explored before is known to be legal. */
+    if (edge == NO_NODE) {
+        if ((move.from >= 64) || (move.to >= 64) || !(board.legal_destinations(move.from) & square_bit(move.to)) || (edges.size() >= max_edges))
+            return false;
+    }
+
+    ChessMoveUndo undo;
+    board.make(move, undo);
+    board_moves++;
+    uint32_t child;
+    if (edge != NO_NODE)
+        child = edges[edge].child;
+    else {
+        /* Merge with the node of the position if another move order reached it already. */
+        uint64_t key = board.position_key();
+        size_t slot = find_slot(key);
+        if (table[slot] == NO_NODE) {
+            if (nodes.size() >= max_nodes) {
+                board.unmake(move, undo);
+                board_moves++;
+                return false;
+            }
+            table[slot] = nodes.size();
+            Node child_node = {key, node, move, NO_NODE};
+            nodes.push_back(child_node);
+        }
+        child = table[slot];
+        Edge new_edge = {move, child, nodes[node].first_edge};
+        nodes[node].first_edge = edges.size();
+        edges.push_back(new_edge);
+    }
+    line.push_back(move);
+    line_nodes.push_back(child);
+    undos.push_back(undo);
+    return true;
+}
+
+bool VariationTree::back() {
+    if (line.empty())
+        return false;
+    board.unmake(line.back(), undos.back());
+    board_moves++;
+    line.pop_back();
+    line_nodes.pop_back();
+    undos.pop_back();
+    return true;
+}
+
+bool VariationTree::go_to_line(ChessMove const *moves, size_t const count) {
+    /* Keep the moves both lines start with. */
+    size_t common = 0;
+    while ((common < line.size()) && (common < count) && (line[common] == moves[common]))
+        common++;
+    while (line.size() > common)
+        back();
+    for (size_t i=common; i<count; i++) {
+        if (!play(moves[i]))
+            return false;
+    }
+    return true;
+}
+
+bool VariationTree::go_to(uint32_t const node) {
+    if (node >= nodes.size())
+        return false;
+    vector<ChessMove> path;
+    for (uint32_t n=node; nodes[n].parent!=NO_NODE; n=nodes[n].parent)
+        path.push_back(nodes[n].move);
+    reverse(path.begin(), path.end());
+    return go_to_line(path.data(), path.size());
+}
+
+uint32_t VariationTree::current() const {
+    return line_nodes.back();
+}
+
+uint32_t VariationTree::root() const {
+    return 0;
+}
+
+ChessBoard const &VariationTree::position() const {
+    return board;
+}
+
+vector<ChessMove> const &VariationTree::current_line() const {
+    return line;
+}
+
+uint32_t VariationTree::find(uint64_t const key) const {
+    return table[find_slot(key)];
+}
+
+int VariationTree::children(uint32_t const node, ChessMove *moves, uint32_t *children) const {
+    int count = 0;
+    for (uint32_t edge=nodes[node].first_edge; (edge!=NO_NODE) && (count<MAX_MOVES); edge=edges[edge].next) {
+        moves[count] = edges[edge].move;
+        children[count] = edges[edge].child;
+        count++;
+    }
+    return count;
+}
+
+size_t VariationTree::node_count() const {
+    return nodes.size();
+}
+
+size_t VariationTree::edge_count() const {
+    return edges.size();
+}
+
+uint64_t VariationTree::board_move_count() const {
+    return board_moves;
+}
+
+size_t VariationTree::memory_bytes() const {
+    return nodes.capacity() * sizeof(Node) + edges.capacity() * sizeof(Edge) + table.size() * sizeof(uint32_t);
+}
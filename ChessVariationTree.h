@@ -0,0 +1,127 @@
+#ifndef CHESSVARIATIONTREE_H
+#define CHESSVARIATIONTREE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ChessBoard.h"
+
+using namespace std;
+
+/* Analysis tree of the variations explored from one position. Every node is a position, created with the move that first reached it and a link to that move's parent, and every explored move is an edge from the position it is played in. A position reached again by another move order is merged with the existing node (found by position key) rather than stored again, so the tree is really a graph and each position is analysed once.
+Nodes and edges live in arenas allocated once by the constructor, with a position key table of fixed size, so the memory used by a session is known in advance (see memory_bytes()) and play() reports when it is full. The tree owns a board set to the current node: moving to another node takes back the moves down to the common part of the two lines and makes the rest with ChessBoard::make() and unmake(), instead of replaying from the root. */
+class VariationTree {
+    public:
+        /* Node index meaning no node. */
+        static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+    private:
+        struct Node {
+            uint64_t key;
+            /* The node and the move this position was first reached from (NO_NODE for the root). */
+            uint32_t parent;
+            ChessMove move;
+            /* First edge of the moves explored from this position (NO_NODE if none). */
+            uint32_t first_edge;
+        };
+
+        struct Edge {
+            ChessMove move;
+            uint32_t child;
+            /* Next edge of the same position (NO_NODE if last). */
+            uint32_t next;
+        };
+
+        vector<Node> nodes;
+        vector<Edge> edges;
+        size_t max_nodes;
+        size_t max_edges;
+
+        /* Open addressing table from position keys to nodes (NO_NODE for empty slots), at most half full. */
+        vector<uint32_t> table;
+        size_t table_mask;
+
+        /* The board at the current node, and the line of moves from the root leading to it with the nodes along it and what unmake() needs for each move. */
+        ChessBoard board;
+        vector<ChessMove> line;
+        vector<uint32_t> line_nodes;
+        vector<ChessMoveUndo> undos;
+
+        /* Number of moves made and taken back on the board by moves between nodes. */
+        uint64_t board_moves;
+
+        /* Function that returns the table slot of a key: the slot holding its node, or the empty slot where it belongs. */
+        size_t find_slot(uint64_t const key) const;
+
+        /* Function that finds the edge of a move from a node.
+        @return the edge index, or NO_NODE if the move has not been explored from it. */
+        uint32_t find_edge(uint32_t const node, ChessMove const &move) const;
+
+    public:
+        /* Constructor that creates the tree with its root and allocates all its memory.
+        @param root: the position the analysis starts from.
+        @param node_capacity: the maximum number of positions (the maximum number of explored moves is twice that). */
+        VariationTree(PackedPosition const &root, size_t const node_capacity);
+
+        /* Destructor that takes back the current line, so the chess pieces captured along it are released with the board. */
+        ~VariationTree();
+
+        VariationTree(VariationTree const &) = delete;
+        VariationTree &operator=(VariationTree const &) = delete;
+
+        /* Method that plays a move from the current node, adding it to the tree unless it was explored before. The position reached becomes the current node: a new node, or the existing node of that position if it was reached by another move order.
+        @param move: the move.
+        @return false if the move is not legal or the tree is full (the current node does not change). */
+        bool play(ChessMove const &move);
+
+        /* Method that takes back the last move of the current line.
+        @return false at the root. */
+        bool back();
+
+        /* Method that makes a line of moves from the root the current one, only taking back and making the moves where it differs from the current line. The moves must have been explored (see play()) or be legal.
+        @param moves, count: the line of moves from the root.
+        @return false if a move is not legal or the tree is full, the current node being the last one reached. */
+        bool go_to_line(ChessMove const *moves, size_t const count);
+
+        /* Method that makes a node current by the line of moves it was first reached by (following the parent links to the root).
+        @param node: a node index.
+        @return false if node is not a node of the tree. */
+        bool go_to(uint32_t const node);
+
+        /* @return the current node. */
+        uint32_t current() const;
+
+        /* @return the root node (always 0). */
+        uint32_t root() const;
+
+        /* @return the board at the current node (to be changed through the tree only). */
+        ChessBoard const &position() const;
+
+        /* @return the line of moves from the root to the current node. */
+        vector<ChessMove> const &current_line() const;
+
+        /* Method that finds the node of a position.
+        @param key: the position key (ChessBoard::position_key()).
+        @return the node, or NO_NODE if the position is not in the tree. */
+        uint32_t find(uint64_t const key) const;
+
+        /* Method that lists the moves explored from a node.
+        @param node: a node index.
+        @param moves: array of at least MAX_MOVES moves to fill.
+        @param children: array of at least MAX_MOVES nodes to fill, the node each move leads to.
+        @return the number of moves. */
+        int children(uint32_t const node, ChessMove *moves, uint32_t *children) const;
+
+        /* @return the number of nodes (positions). */
+        size_t node_count() const;
+
+        /* @return the number of edges (explored moves), more than node_count() - 1 when move orders transpose. */
+        size_t edge_count() const;
+
+        /* @return the number of moves made and taken back on the board so far to move between nodes. */
+        uint64_t board_move_count() const;
+
+        /* @return the bytes allocated for the nodes, edges and key table, fixed by the node capacity. */
+        size_t memory_bytes() const;
+};
+
+#endif